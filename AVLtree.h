@@ -1,6 +1,17 @@
 #ifndef AVLTREE_H
 #define AVLTREE_H
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "Snapshot.h"
+#include "MemoryResource.h"
+#include "MemoryUsage.h"
 
 enum class NodeType {
 	LEAF,
@@ -19,14 +30,20 @@ public:
 	V value;
 	K key;  //same idea as STL MAP
 	int height; //the length of the longest route from the current vertex to a leaf
+	uint8_t flags; //RelaxedAVLtree's marks (RELAXED_DIRTY, RELAXED_TOMBSTONE), sits in the padding and stays 0 otherwise
 
 	//default constructor
-	Tnode() : left(nullptr), right(nullptr), parent(nullptr), value(NULL),
-		key(NULL), height(0) {}
+	Tnode() : left(nullptr), right(nullptr), parent(nullptr), value(),
+		key(), height(0), flags(0) {}
 
-	//constructor
-	Tnode(K key ,V value) : left(nullptr), right(nullptr), parent(nullptr), value(value),
-		key(key), height(0) {}
+	//constructors
+	Tnode(const K& key, const V& value) : left(nullptr), right(nullptr), parent(nullptr), value(value),
+		key(key), height(0), flags(0) {}
+	Tnode(K&& key, V&& value) : left(nullptr), right(nullptr), parent(nullptr), value(std::move(value)),
+		key(std::move(key)), height(0), flags(0) {}
+	template<class KK, class... Args>
+	Tnode(std::in_place_t, KK&& key, Args&&... args) : left(nullptr), right(nullptr), parent(nullptr),
+		value(std::forward<Args>(args)...), key(std::forward<KK>(key)), height(0), flags(0) {} //builds value in place
 
 	~Tnode() {
 		left = nullptr;
@@ -35,31 +52,44 @@ public:
 	}
 
 	//copy
-	Tnode(const Tnode<K, V>& node) {
+	Tnode(const Tnode<K, V>& node) : left(node.left), right(node.right), parent(node.parent),
+		value(node.value), key(node.key), height(node.height), flags(node.flags) {}
+
+	//move
+	Tnode(Tnode<K, V>&& node) : left(node.left), right(node.right), parent(node.parent),
+		value(std::move(node.value)), key(std::move(node.key)), height(node.height), flags(node.flags) {}
+
+	//operators
+	Tnode<K, V>& operator= (const Tnode<K, V>& node) {
+		if (this == &node) {
+			return *this;
+		}
 		left = node.left;
 		right = node.right;
 		parent = node.parent;
 		value = node.value;
 		key = node.key;
 		height = node.height;
+		flags = node.flags;
+		return *this;
 	}
 
-	//operators
-	Tnode<K, V>& operator= (const Tnode<K, V>& node) {
+	Tnode<K, V>& operator=(Tnode<K, V>&& node) {
 		if (this == &node) {
 			return *this;
 		}
 		left = node.left;
 		right = node.right;
 		parent = node.parent;
-		value = node.value;
-		key = node.key;
+		value = std::move(node.value);
+		key = std::move(node.key);
 		height = node.height;
+		flags = node.flags;
 		return *this;
 	}
 
 	bool operator==(const Tnode<K,V>& node) const {
-		return key == node->key;
+		return key == node.key;
 	}
 
 	//Balance Factor
@@ -78,73 +108,411 @@ public:
 	}
 };
 
+/*extra per-node data derived from the node's subtree (e.g. the max endpoint in IntervalTree.h).
+  updateNodeHeight calls update on every node whose subtree changed - insert/remove paths and rotations -
+  so keys that carry such data only need to specialize this*/
+template<class K>
+struct SubtreeAugment {
+	template<class V>
+	static void update(Tnode<K, V>*) {}
+};
+
+/********************************** TREE COUNTERS **********************************/
+enum class TreeCounter {
+	FIND_CALLS, //remove's own lookups count as finds
+	FIND_COMPARISONS,
+	INSERT_CALLS,
+	INSERT_COMPARISONS,
+	ROTATIONS_LL, //a rebalance counts once, as the kind rotate() chose
+	ROTATIONS_RR,
+	ROTATIONS_LR,
+	ROTATIONS_RL,
+	PATH_NODES, //nodes visited by updatePathHeight
+	SWAPS, //swapTwoNodes calls
+	COUNT
+};
+
+/*copy of the counters at one point in time*/
+struct AVLtreeStats {
+	uint64_t find_calls;
+	uint64_t find_comparisons;
+	uint64_t insert_calls;
+	uint64_t insert_comparisons;
+	uint64_t rotations_ll;
+	uint64_t rotations_rr;
+	uint64_t rotations_lr;
+	uint64_t rotations_rl;
+	uint64_t path_nodes;
+	uint64_t swaps;
+};
+
+/*AVLtree's counter policy (its third template parameter). the tree calls count() at every counted event
+  and operation() once per find/insert. NoTreeStats is the default - its calls are empty and compile away,
+  and it sits in the tree's padding so the tree does not grow either*/
+struct NoTreeStats {
+	void count(TreeCounter, uint64_t = 1) {}
+	void operation(TreeCounter) {}
+	AVLtreeStats snapshot() const {
+		return AVLtreeStats();
+	}
+};
+
+typedef void (*TreeStatsHook)(const AVLtreeStats& stats, void* context);
+
+/*counts everything and, if a hook is set, hands a snapshot to it every period operations (on the thread
+  running the operation) - e.g. to feed a metrics exporter. not synchronized, like the tree itself*/
+class CountingTreeStats {
+	uint64_t counts[(int)TreeCounter::COUNT];
+	TreeStatsHook hook;
+	void* context;
+	uint64_t period;
+	uint64_t until_report;
+
+public:
+	CountingTreeStats() : hook(nullptr), context(nullptr), period(0), until_report(0) {
+		reset();
+	}
+	void count(TreeCounter counter, uint64_t n = 1) {
+		counts[(int)counter] += n;
+	}
+	void operation(TreeCounter counter) {
+		counts[(int)counter]++;
+		if (hook != nullptr && --until_report == 0) {
+			report();
+		}
+	}
+	uint64_t get(TreeCounter counter) const {
+		return counts[(int)counter];
+	}
+	AVLtreeStats snapshot() const;
+	void reset();
+	void setHook(TreeStatsHook _hook, void* _context, uint64_t _period); //nullptr removes the hook
+	void report(); //calls the hook now
+};
+
+inline AVLtreeStats CountingTreeStats::snapshot() const
+{
+	AVLtreeStats stats;
+	stats.find_calls = counts[(int)TreeCounter::FIND_CALLS];
+	stats.find_comparisons = counts[(int)TreeCounter::FIND_COMPARISONS];
+	stats.insert_calls = counts[(int)TreeCounter::INSERT_CALLS];
+	stats.insert_comparisons = counts[(int)TreeCounter::INSERT_COMPARISONS];
+	stats.rotations_ll = counts[(int)TreeCounter::ROTATIONS_LL];
+	stats.rotations_rr = counts[(int)TreeCounter::ROTATIONS_RR];
+	stats.rotations_lr = counts[(int)TreeCounter::ROTATIONS_LR];
+	stats.rotations_rl = counts[(int)TreeCounter::ROTATIONS_RL];
+	stats.path_nodes = counts[(int)TreeCounter::PATH_NODES];
+	stats.swaps = counts[(int)TreeCounter::SWAPS];
+	return stats;
+}
+
+inline void CountingTreeStats::reset()
+{
+	for (int i = 0; i < (int)TreeCounter::COUNT; i++) {
+		counts[i] = 0;
+	}
+	until_report = period;
+}
+
+inline void CountingTreeStats::setHook(TreeStatsHook _hook, void* _context, uint64_t _period)
+{
+	hook = _hook;
+	context = _context;
+	period = _period > 0 ? _period : 1;
+	until_report = period;
+}
+
+inline void CountingTreeStats::report()
+{
+	until_report = period;
+	if (hook != nullptr) {
+		hook(snapshot(), context);
+	}
+}
+
+/********************************** TREE RECLAIMER **********************************/
+/*background thread that destroys the nodes of trees handed to it by AVLtree::clear(reclaimer),
+  so freeing a big tree is off the caller's path. the trees' resources must be thread safe
+  and outlive the reclaimer, whose destructor finishes every pending tree first*/
+class TreeReclaimer {
+	struct Job {
+		void* root;
+		void (*destroy)(void* root, std::pmr::memory_resource* resource);
+		std::pmr::memory_resource* resource;
+		Job* next;
+	};
+
+	std::mutex lock;
+	std::condition_variable wake; //new job or stopping for the worker, a finished job for drain
+	Job* jobs; //newest first
+	int pending; //handed over and not destroyed yet
+	bool stopping;
+	std::thread worker;
+
+	void run();
+
+public:
+	TreeReclaimer() : jobs(nullptr), pending(0), stopping(false) {
+		worker = std::thread(&TreeReclaimer::run, this);
+	}
+	~TreeReclaimer();
+	TreeReclaimer(const TreeReclaimer& reclaimer) = delete;
+	TreeReclaimer& operator=(const TreeReclaimer& reclaimer) = delete;
+	template<class K, class V>
+	void reclaim(Tnode<K, V>* root, std::pmr::memory_resource* resource); //root must be detached from its tree
+	void drain(); //waits until every tree handed over so far is destroyed
+	int getPending();
+};
+
 /**********************************AVL TREE IMPLEMENTATION **********************************/
-template <class K, class V>
+template <class K, class V, class S = NoTreeStats>
 class AVLtree {
+protected: //RelaxedAVLtree inserts and rebuilds on its own
 	Tnode<K, V>* root;
 	int size;
+	S stats; //right after size, an empty policy takes no room
+	std::pmr::memory_resource* resource; //all nodes are allocated from here
+
+private:
+	template<class KK, class... Args>
+	Tnode<K, V>* emplaceAUX(KK&& key, Args&&... args);
 
 public:
-	AVLtree() : root(nullptr), size(0) {};
+	explicit AVLtree(std::pmr::memory_resource* _resource = std::pmr::get_default_resource())
+		: root(nullptr), size(0), resource(_resource) {};
 	~AVLtree();
-	AVLtree(const AVLtree<K, V>& tree);
-	AVLtree<K, V>& operator=(const AVLtree<K, V>& tree);
+	AVLtree(const AVLtree<K, V, S>& tree);
+	AVLtree(AVLtree<K, V, S>&& tree); //takes tree's nodes and resource
+	AVLtree<K, V, S>& operator=(const AVLtree<K, V, S>& tree);
+	AVLtree<K, V, S>& operator=(AVLtree<K, V, S>&& tree);
 	int getSize();
+	std::pmr::memory_resource* getResource();
+	MemoryUsage memoryUsage() const; //nodes and the tree object, from the node count
 	Tnode<K, V>* getRoot();
 	void setRoot(Tnode<K, V>* new_root);
-	Tnode<K, V>* find(K key,Tnode<K,V>* current);
-	Tnode<K, V>* insert(K key, V value); //inserts node while maintainig AVL rules 
-	bool remove(K key,Tnode<K,V>* node); //MUST MAINTAIN AVL RULES AFTER REMOVING (ROTATE)
+	Tnode<K, V>* find(const K& key,Tnode<K,V>* current);
+	Tnode<K, V>* insert(const K& key, const V& value); //inserts node while maintainig AVL rules 
+	Tnode<K, V>* insert(K&& key, V&& value); //key and value are left untouched if the key already exists
+	template<class... Args>
+	Tnode<K, V>* emplace(K key, Args&&... args); //constructs the value inside the new node
+	bool remove(const K& key,Tnode<K,V>* node); //MUST MAINTAIN AVL RULES AFTER REMOVING (ROTATE)
 	void rotateLR(Tnode<K, V>* node);
 	void rotateLL(Tnode<K, V>* node);
 	void rotateRL(Tnode<K, V>* node);
 	void rotateRR(Tnode<K, V>* node);
 	void printInOrder(Tnode<K, V>* current);
 	Tnode<K, V>* swapTwoNodes(Tnode<K, V>* node);
+	bool save(const char* path); //binary snapshot, K and V must be trivially copyable
+	bool load(const char* path); //replaces the tree with the snapshot's nodes, no rotations
+	S& getStats() { //a copied or moved tree starts with fresh counters
+		return stats;
+	}
+	AVLtreeStats getStatsSnapshot() const {
+		return stats.snapshot();
+	}
+	/*with threads > 1 the subtrees below the top levels are handled by separate threads and the resource must
+	  be thread safe (like the default one or a synchronized_pool_resource), threads = 0 uses all hardware threads*/
+	void clear(int threads = 1); //deletes all nodes
+	void clear(TreeReclaimer& reclaimer); //empties the tree now, the nodes are deleted by the reclaimer's thread
+	void copyFrom(const AVLtree<K, V, S>& tree, int threads = 1); //like operator=, nodes go to this tree's resource
 
 };
 
 /*AVL TREE FUNCTION IMPLEMENTATIONS*/
 
 //destructor
+/*post order without recursion - goes down to a leaf, deletes it and climbs back through parent.
+  the subtree's parent (if any) is not touched, the caller unlinks the subtree*/
 template<class K, class V>
-static void treeDestructorAUX(Tnode<K, V>* node) {
+static void treeDestructorAUX(Tnode<K, V>* node, std::pmr::memory_resource* resource) {
 	if (node == nullptr) {
 		return;
 	}
-	treeDestructorAUX(node->left);
-	treeDestructorAUX(node->right);
-	delete node;
+	Tnode<K, V>* stop = node->parent;
+	while (node != stop) {
+		if (node->left != nullptr) {
+			node = node->left;
+		}
+		else if (node->right != nullptr) {
+			node = node->right;
+		}
+		else {
+			Tnode<K, V>* parent = node->parent;
+			if (parent != stop) {
+				if (parent->left == node) {
+					parent->left = nullptr;
+				}
+				else {
+					parent->right = nullptr;
+				}
+			}
+			destroyObject(resource, node);
+			node = parent;
+		}
+	}
 }
 
-template<class K, class V>
-inline AVLtree<K, V>::~AVLtree()
+template<class K, class V, class S>
+inline AVLtree<K, V, S>::~AVLtree()
 {
-	treeDestructorAUX(this->root);
+	treeDestructorAUX(this->root, resource);
 }
 
 //copy connstrucor
+/*a subtree left for the caller to copy and link under dest_parent*/
+template<class K, class V>
+struct TreeCopyTask {
+	Tnode<K, V>* src;
+	Tnode<K, V>* dest_parent;
+	bool to_left;
+};
+
 template<class K, class V>
-static Tnode<K,V>* treeCopyAUX(Tnode<K, V>* src_node) { 
-	if (src_node == nullptr) { //reached a leaf
+static Tnode<K, V>* treeCopyNodeAUX(Tnode<K, V>* src_node, Tnode<K, V>* dest_parent, std::pmr::memory_resource* resource) {
+	Tnode<K, V>* dest_node = createObject<Tnode<K, V>>(resource, *src_node);
+	dest_node->left = nullptr;
+	dest_node->right = nullptr;
+	dest_node->parent = dest_parent;
+	return dest_node;
+}
+
+/*pre order without recursion - the source and the copy are walked in lockstep through their parent links,
+  came_from is the child the walk just climbed back from (nullptr when it came down from the parent).
+  children below max_depth are not copied but added to tasks (-1 copies everything)*/
+template<class K, class V>
+static Tnode<K,V>* treeCopyAUX(Tnode<K, V>* src_root, std::pmr::memory_resource* resource, int max_depth = -1,
+	TreeCopyTask<K, V>* tasks = nullptr, int* task_count = nullptr) {
+	if (src_root == nullptr) {
 		return nullptr;
 	}
-	Tnode<K, V>* dest_node = new Tnode<K, V>(*src_node);
-	dest_node->left = treeCopyAUX(src_node->left);
-	dest_node->right = treeCopyAUX(src_node->right);
-	if (src_node->left != nullptr) { //if left son exists, set parent
-		(dest_node->left)->parent = dest_node;
+	Tnode<K, V>* dest_root = treeCopyNodeAUX(src_root, (Tnode<K, V>*)nullptr, resource);
+	Tnode<K, V>* src = src_root;
+	Tnode<K, V>* dest = dest_root;
+	Tnode<K, V>* came_from = nullptr;
+	int depth = 0;
+	while (true) {
+		Tnode<K, V>* child = nullptr;
+		bool to_left = false;
+		if (came_from == nullptr && src->left != nullptr) {
+			child = src->left;
+			to_left = true;
+		}
+		else if (came_from != src->right && src->right != nullptr) {
+			child = src->right;
+		}
+		if (child == nullptr) { //both sides done, climb
+			if (src == src_root) {
+				return dest_root;
+			}
+			came_from = src;
+			src = src->parent;
+			dest = dest->parent;
+			depth--;
+			continue;
+		}
+		if (depth == max_depth) {
+			tasks[(*task_count)++] = { child, dest, to_left };
+			came_from = child; //as if it was copied already
+			continue;
+		}
+		Tnode<K, V>* copy = treeCopyNodeAUX(child, dest, resource);
+		if (to_left) {
+			dest->left = copy;
+		}
+		else {
+			dest->right = copy;
+		}
+		src = child;
+		dest = copy;
+		came_from = nullptr;
+		depth++;
+	}
+}
+
+/*threads to use for a tree of size nodes - small trees arent worth a thread each*/
+static inline int treeThreadsAUX(int threads, int size) {
+	if (threads <= 0) {
+		threads = (int)std::thread::hardware_concurrency();
 	}
-	if (src_node->right != nullptr) {
-		(dest_node->right)->parent = dest_node;
+	if (threads > size / 65536 + 1) {
+		threads = size / 65536 + 1;
 	}
-	return dest_node;
+	return threads > 0 ? threads : 1;
+}
+
+/*depth at which a tree splits into enough subtrees to keep threads busy (about 8 per thread)*/
+static inline int treeSplitDepthAUX(int threads) {
+	int depth = 0;
+	while ((1 << depth) < threads * 8) {
+		depth++;
+	}
+	return depth;
+}
+
+/*runs task(0..count-1) on threads threads, the caller being one of them. tasks are handed out one at a time*/
+template<class F>
+static void treeRunTasksAUX(int count, int threads, F task) {
+	std::atomic<int> next(0);
+	auto work = [&next, count, &task]() {
+		for (int i = next++; i < count; i = next++) {
+			task(i);
+		}
+	};
+	std::thread* workers = new std::thread[threads - 1];
+	for (int t = 0; t < threads - 1; t++) {
+		workers[t] = std::thread(work);
+	}
+	work();
+	for (int t = 0; t < threads - 1; t++) {
+		workers[t].join();
+	}
+	delete[] workers;
 }
 
+/*cuts every subtree rooted at depth off the tree and stores it in subtrees (room for 2^depth),
+  the top levels stay behind as a smaller tree. returns the number of subtrees*/
 template<class K, class V>
-AVLtree<K, V>::AVLtree(const AVLtree<K, V>& tree)
+static int treeSplitAUX(Tnode<K, V>* root, int depth, Tnode<K, V>** subtrees) {
+	if (root == nullptr || depth == 0) {
+		return 0;
+	}
+	Tnode<K, V>** level = new Tnode<K, V>*[1 << (depth - 1)];
+	Tnode<K, V>** next_level = new Tnode<K, V>*[1 << (depth - 1)];
+	int level_size = 1, count = 0;
+	level[0] = root;
+	for (int d = 1; d <= depth && level_size > 0; d++) {
+		int next_size = 0;
+		for (int i = 0; i < level_size; i++) {
+			Tnode<K, V>* children[2] = { level[i]->left, level[i]->right };
+			for (int c = 0; c < 2; c++) {
+				if (children[c] == nullptr) {
+					continue;
+				}
+				if (d < depth) {
+					next_level[next_size++] = children[c];
+					continue;
+				}
+				children[c]->parent = nullptr;
+				subtrees[count++] = children[c];
+			}
+			if (d == depth) {
+				level[i]->left = nullptr;
+				level[i]->right = nullptr;
+			}
+		}
+		std::swap(level, next_level);
+		level_size = next_size;
+	}
+	delete[] level;
+	delete[] next_level;
+	return count;
+}
+
+/*like the std::pmr containers, a copy uses the default resource and not the source's one*/
+template<class K, class V, class S>
+AVLtree<K, V, S>::AVLtree(const AVLtree<K, V, S>& tree) : resource(std::pmr::get_default_resource())
 {
-	root = treeCopyAUX(tree.root);
+	root = treeCopyAUX(tree.root, resource);
 	if (root != nullptr) {
 		root->parent = nullptr;
 		size = tree.size;
@@ -153,14 +521,16 @@ AVLtree<K, V>::AVLtree(const AVLtree<K, V>& tree)
 		size = 0;
 }
 
-template<class K, class V>
-AVLtree<K, V>& AVLtree<K, V>::operator=(const AVLtree<K, V>& tree)
+template<class K, class V, class S>
+AVLtree<K, V, S>& AVLtree<K, V, S>::operator=(const AVLtree<K, V, S>& tree)
 {
 	if (this == &tree) {
 		return *this;
 	}
+	treeDestructorAUX(root, resource); //nodes are copied into this tree's resource
+	root = nullptr;
 	if (tree.root != nullptr) {
-		root = treeCopyAUX(tree.root);
+		root = treeCopyAUX(tree.root, resource);
 		root->parent = nullptr;
 		size = tree.size;
 	}
@@ -169,33 +539,78 @@ AVLtree<K, V>& AVLtree<K, V>::operator=(const AVLtree<K, V>& tree)
 	return *this;
 }
 
-template<class K, class V>
-int AVLtree<K, V>::getSize()
+template<class K, class V, class S>
+AVLtree<K, V, S>::AVLtree(AVLtree<K, V, S>&& tree) : root(tree.root), size(tree.size), resource(tree.resource)
+{
+	tree.root = nullptr;
+	tree.size = 0;
+}
+
+/*nodes can only be taken over from a tree of the same resource, otherwise they are copied like operator=*/
+template<class K, class V, class S>
+AVLtree<K, V, S>& AVLtree<K, V, S>::operator=(AVLtree<K, V, S>&& tree)
+{
+	if (this == &tree) {
+		return *this;
+	}
+	if (resource != tree.resource) {
+		*this = tree;
+		return *this;
+	}
+	treeDestructorAUX(root, resource);
+	root = tree.root;
+	size = tree.size;
+	tree.root = nullptr;
+	tree.size = 0;
+	return *this;
+}
+
+template<class K, class V, class S>
+int AVLtree<K, V, S>::getSize()
 {
 	return size;
 }
 
-template<class K, class V>
-Tnode<K, V>* AVLtree<K, V>::getRoot()
+template<class K, class V, class S>
+std::pmr::memory_resource* AVLtree<K, V, S>::getResource()
+{
+	return resource;
+}
+
+/*a node's links, height, flags and padding are overhead*/
+template<class K, class V, class S>
+MemoryUsage AVLtree<K, V, S>::memoryUsage() const
+{
+	MemoryUsage usage = {};
+	usage.payload = (size_t)size * (sizeof(K) + sizeof(V));
+	usage.overhead = sizeof(AVLtree<K, V, S>) + (size_t)size * sizeof(Tnode<K, V>) - usage.payload;
+	usage.allocations = size;
+	return usage;
+}
+
+template<class K, class V, class S>
+Tnode<K, V>* AVLtree<K, V, S>::getRoot()
 {
 	return root;
 }
 
-template<class K, class V>
-void AVLtree<K, V>::setRoot(Tnode<K, V>* new_root)
+template<class K, class V, class S>
+void AVLtree<K, V, S>::setRoot(Tnode<K, V>* new_root)
 {
 	root = new_root;
 }
 
-template<class K, class V>
-Tnode<K, V>* AVLtree<K, V>::find(K key, Tnode<K,V>* current)
+template<class K, class V, class S>
+Tnode<K, V>* AVLtree<K, V, S>::find(const K& key, Tnode<K,V>* current)
 {
-	if(current == nullptr) return nullptr;
-	if (key == current->key) return current;
-	if (key > current->key) {
-		return find(key, current->right);
+	stats.operation(TreeCounter::FIND_CALLS);
+	while (current != nullptr) {
+		stats.count(TreeCounter::FIND_COMPARISONS);
+		if (key == current->key) return current;
+		stats.count(TreeCounter::FIND_COMPARISONS);
+		current = key > current->key ? current->right : current->left;
 	}
-	return find(key, current->left);
+	return nullptr;
 }
 
 /*this function updates the node's height field*/
@@ -216,12 +631,14 @@ static void updateNodeHeight(Tnode<K, V>* node) {
 	}
 	else
 		node->height = hL + 1;
+	SubtreeAugment<K>::update(node);
 }
 
 /* this function updates the heights of all nodes in path from current node up to the root and rotates*/
-template<class K, class V>
-static void updatePathHeight(Tnode<K, V>* node, AVLtree<K, V>* tree) {
+template<class K, class V, class S>
+static void updatePathHeight(Tnode<K, V>* node, AVLtree<K, V, S>* tree) {
 	while (node != nullptr) { 
+		tree->getStats().count(TreeCounter::PATH_NODES);
 		updateNodeHeight(node);
 		if (node->getBF() == 2 || node->getBF() == -2) {
 			rotate(tree, node);
@@ -250,49 +667,67 @@ static NodeType getNodeType(Tnode<K, V>* node) {
 	return NodeType::HAS_TWO_CHILDREN;
 }
 
-template<class K, class V>
-Tnode<K,V>* AVLtree<K, V>::insert(K key, V value)
+template<class K, class V, class S>
+Tnode<K,V>* AVLtree<K, V, S>::insert(const K& key, const V& value)
 {
-	Tnode<K, V>* new_node = new Tnode<K, V>(key, value);
-	if (new_node == nullptr) {
-		//throw std::exception("Memory Error!");
-	}
+	return emplaceAUX(key, value);
+}
+
+template<class K, class V, class S>
+Tnode<K,V>* AVLtree<K, V, S>::insert(K&& key, V&& value)
+{
+	return emplaceAUX(std::move(key), std::move(value));
+}
+
+template<class K, class V, class S>
+template<class... Args>
+Tnode<K,V>* AVLtree<K, V, S>::emplace(K key, Args&&... args)
+{
+	return emplaceAUX(std::move(key), std::forward<Args>(args)...);
+}
+
+/*finds where key belongs first, the node (and the key/value moved into it) is only created if key is new*/
+template<class K, class V, class S>
+template<class KK, class... Args>
+Tnode<K,V>* AVLtree<K, V, S>::emplaceAUX(KK&& key, Args&&... args)
+{
+	stats.operation(TreeCounter::INSERT_CALLS);
 	if (root == nullptr) { //tree is empty add root
-		root = new_node;
+		root = createObject<Tnode<K, V>>(resource, std::in_place, std::forward<KK>(key), std::forward<Args>(args)...);
 		size++;
 		return root;
 	}
 	Tnode<K, V>* current =  root;
-	while (current != nullptr) { //while current != leaf
+	bool to_left;
+	while (true) { //while current != leaf
+		stats.count(TreeCounter::INSERT_COMPARISONS);
 		if (key == current->key) { //key already exists
 			return current;
 		}
-		if (key < current->key && current->left != nullptr) {
-			current = current->left;
-		}
-		if (key < current->key && current->left == nullptr) {
-			current->left = new_node; //left insertion 
-			new_node->parent = current;
-			size++;
-			break;
-		}
-		if (key > current->key && current->right != nullptr) {
-			current = current->right;
-		}
-		if(key > current->key && current->right == nullptr) {
-			current->right = new_node; //right insertion
-			new_node->parent = current;
-			size++;
+		stats.count(TreeCounter::INSERT_COMPARISONS);
+		to_left = key < current->key;
+		Tnode<K, V>* next = to_left ? current->left : current->right;
+		if (next == nullptr) {
 			break;
 		}
+		current = next;
+	}
+	Tnode<K, V>* new_node = createObject<Tnode<K, V>>(resource, std::in_place, std::forward<KK>(key), std::forward<Args>(args)...);
+	if (to_left) {
+		current->left = new_node; //left insertion 
 	}
+	else {
+		current->right = new_node; //right insertion
+	}
+	new_node->parent = current;
+	size++;
 	updatePathHeight(current, this); //update node heights up to the root
 	return new_node;
 }
 
 /*parameter node is the root of the tree/subtree the binary search should start from*/
-template<class K, class V>
-bool AVLtree<K, V>::remove(K key, Tnode<K,V>* node)
+template<class K, class V, class S>
+bool AVLtree<K, V, S>::remove(const K& key, Tnode<K,V>* node)
 {
 	Tnode<K, V>* node_remove = find(key, node);
 	Tnode<K, V>* swapWith;
@@ -303,7 +738,7 @@ bool AVLtree<K, V>::remove(K key, Tnode<K,V>* node)
 	case NodeType::LEAF:
 		if (node_parent == nullptr) { //node is the root
 			this->root = nullptr;
-			delete node_remove;
+			destroyObject(resource, node_remove);
 			size--;
 			return true;
 		}
@@ -313,7 +748,7 @@ bool AVLtree<K, V>::remove(K key, Tnode<K,V>* node)
 		else { //node is right leaf
 			node_parent->right = nullptr; 
 		}
-		delete node_remove; //delete node
+		destroyObject(resource, node_remove); //delete node
 		updatePathHeight(node_parent, this);
 		size--;
 		return true;
@@ -321,20 +756,20 @@ bool AVLtree<K, V>::remove(K key, Tnode<K,V>* node)
 		if (node_remove == this->root) { //the node to be deleted is the root
 			(node_remove->left)->parent = nullptr; 
 			this->root = node_remove->left;
-			delete node_remove;
+			destroyObject(resource, node_remove);
 		}
 		else { 
 			if (node_parent->left == node_remove) { //LL
 				node_parent->left = node_remove->left; 
 				(node_remove->left)->parent = node_parent;
-				updateNodeHeight(node_parent);
-				delete node_remove;
+				destroyObject(resource, node_remove);
+				updatePathHeight(node_parent, this);
 			}
 			else { 
 				node_parent->right = node_remove->left;//RL
 				(node_remove->left)->parent = node_parent;
-				updateNodeHeight(node_parent);
-				delete node_remove;
+				destroyObject(resource, node_remove);
+				updatePathHeight(node_parent, this);
 			}
 		}
 		size--;
@@ -343,20 +778,20 @@ bool AVLtree<K, V>::remove(K key, Tnode<K,V>* node)
 		if (node_remove == this->root) { //the node to be deleted is the root
 			(node_remove->right)->parent = nullptr;
 			this->root = node_remove->right;
-			delete node_remove;
+			destroyObject(resource, node_remove);
 		}
 		else {
 			if (node_parent->right == node_remove) { //RR
 				node_parent->right = node_remove->right;
 				(node_remove->right)->parent = node_parent;
-				updateNodeHeight(node_parent);
-				delete node_remove;
+				destroyObject(resource, node_remove);
+				updatePathHeight(node_parent, this);
 			}
 			else {
 				node_parent->left = node_remove->right; //LR
 				(node_remove->right)->parent = node_parent;
-				updateNodeHeight(node_parent);
-				delete node_remove;
+				destroyObject(resource, node_remove);
+				updatePathHeight(node_parent, this);
 			}
 		}
 		size--;
@@ -374,9 +809,10 @@ bool AVLtree<K, V>::remove(K key, Tnode<K,V>* node)
 /*find the node which should be deleted, mark its right son, find the lowest key of the son's LEFT sided sons
    then swap between the node and the farthest left node found, update left+right sons and parents accordingly
    function returns pointer to the node we want to delete*/
-template<class K, class V>
-Tnode<K,V>* AVLtree<K, V>::swapTwoNodes(Tnode<K,V>* node)
+template<class K, class V, class S>
+Tnode<K,V>* AVLtree<K, V, S>::swapTwoNodes(Tnode<K,V>* node)
 {
+	stats.count(TreeCounter::SWAPS);
 	Tnode<K, V>* swapWith = node->right;
 	//Tnode<K, V> temp = *node;
 	if (node == nullptr) {
@@ -461,6 +897,9 @@ Tnode<K,V>* AVLtree<K, V>::swapTwoNodes(Tnode<K,V>* node)
 	int temp_height = node->height;
 	node->height = swapWith->height;
 	swapWith->height = temp_height;
+	for (Tnode<K, V>* current = node; current != swapWith->parent; current = current->parent) {
+		SubtreeAugment<K>::update(current); //node moved down, the nodes up to swapWith hold different keys now
+	}
 	//swap nodes
 	/*
 	node->key = swapWith->key;
@@ -472,8 +911,8 @@ Tnode<K,V>* AVLtree<K, V>::swapTwoNodes(Tnode<K,V>* node)
 }
 
 
-template<class K, class V>
-void AVLtree<K, V>::rotateLR(Tnode<K, V>* current)
+template<class K, class V, class S>
+void AVLtree<K, V, S>::rotateLR(Tnode<K, V>* current)
 {
 	if (current == nullptr) {
 		//throw std::exception("Err: node is a nullptr");
@@ -482,8 +921,8 @@ void AVLtree<K, V>::rotateLR(Tnode<K, V>* current)
 	rotateLL(current);
 }
 
-template<class K, class V>
-void AVLtree<K, V>::rotateRL(Tnode<K, V>* current)
+template<class K, class V, class S>
+void AVLtree<K, V, S>::rotateRL(Tnode<K, V>* current)
 {
 	if (current == nullptr) {
 		//throw std::exception("Err: node is a nullptr");
@@ -493,23 +932,27 @@ void AVLtree<K, V>::rotateRL(Tnode<K, V>* current)
 }
 
 
-template<class K, class V>
- static void rotate(AVLtree<K, V>* tree, Tnode<K, V>* current) {
+template<class K, class V, class S>
+ static void rotate(AVLtree<K, V, S>* tree, Tnode<K, V>* current) {
  	 if (current->getBF() == 2 && (current->left) != nullptr && (current->left)->getBF() >= 0) {
+		tree->getStats().count(TreeCounter::ROTATIONS_LL);
 		tree->rotateLL(current);
 	}
 	else if (current->getBF() == 2 && (current->left) != nullptr && (current->left)->getBF() == -1) {
+		 tree->getStats().count(TreeCounter::ROTATIONS_LR);
 		 tree->rotateLR(current);
 	}
 	else if (current->getBF() == -2 && (current->right) != nullptr && (current->right)->getBF() == 1) {
+		 tree->getStats().count(TreeCounter::ROTATIONS_RL);
 		 tree->rotateRL(current);
 	}
 	else if (current->getBF() == -2 && (current->right) != nullptr && (current->right)->getBF() <= 0) {
+		 tree->getStats().count(TreeCounter::ROTATIONS_RR);
 		 tree->rotateRR(current);
 	}
 }
-template<class K, class V>
-void AVLtree<K, V>::rotateLL(Tnode<K, V>* current)
+template<class K, class V, class S>
+void AVLtree<K, V, S>::rotateLL(Tnode<K, V>* current)
 {
 	if (current == nullptr) {
 		//throw std::exception("Exeption: node is a nullptr");
@@ -546,8 +989,8 @@ void AVLtree<K, V>::rotateLL(Tnode<K, V>* current)
 	}
 }
 
-template<class K, class V>
-void AVLtree<K, V>::rotateRR(Tnode<K, V>* current)
+template<class K, class V, class S>
+void AVLtree<K, V, S>::rotateRR(Tnode<K, V>* current)
 {
 	if (current == nullptr) {
 		//throw std::exception("Err: node is a nullptr");
@@ -584,14 +1027,302 @@ void AVLtree<K, V>::rotateRR(Tnode<K, V>* current)
 	}
 }
 
-template<class K, class V>
-void AVLtree<K, V>::printInOrder(Tnode<K, V>* current)
+/*in order without recursion - successors are found through the parent links, the walk ends when it
+  climbs out of current's subtree*/
+template<class K, class V, class S>
+void AVLtree<K, V, S>::printInOrder(Tnode<K, V>* current)
 {
 	if (current == nullptr) return;
-	printInOrder(current->left);
-	std::cout << current->key << " ";
-	printInOrder(current->right);
-	
+	Tnode<K, V>* stop = current->parent;
+	while (current->left != nullptr) current = current->left;
+	while (current != stop) {
+		std::cout << current->key << " ";
+		if (current->right != nullptr) {
+			current = current->right;
+			while (current->left != nullptr) current = current->left;
+		}
+		else {
+			while (current->parent != stop && current == current->parent->right) current = current->parent;
+			current = current->parent;
+		}
+	}
+}
+
+template<class K, class V, class S>
+void AVLtree<K, V, S>::clear(int threads)
+{
+	threads = treeThreadsAUX(threads, size);
+	if (threads > 1) {
+		int depth = treeSplitDepthAUX(threads);
+		Tnode<K, V>** subtrees = new Tnode<K, V>*[1 << depth];
+		int count = treeSplitAUX(root, depth, subtrees);
+		treeRunTasksAUX(count, threads, [this, subtrees](int i) { treeDestructorAUX(subtrees[i], resource); });
+		delete[] subtrees;
+	}
+	treeDestructorAUX(root, resource); //the whole tree, or what is left above the split
+	root = nullptr;
+	size = 0;
+}
+
+template<class K, class V, class S>
+void AVLtree<K, V, S>::clear(TreeReclaimer& reclaimer)
+{
+	if (root != nullptr) {
+		reclaimer.reclaim(root, resource);
+	}
+	root = nullptr;
+	size = 0;
+}
+
+/*the top levels are copied first, the subtrees below them are copied by the threads and linked in*/
+template<class K, class V, class S>
+void AVLtree<K, V, S>::copyFrom(const AVLtree<K, V, S>& tree, int threads)
+{
+	if (this == &tree) {
+		return;
+	}
+	clear(threads);
+	threads = treeThreadsAUX(threads, tree.size);
+	if (threads <= 1) {
+		root = treeCopyAUX(tree.root, resource);
+		size = tree.size;
+		return;
+	}
+	int depth = treeSplitDepthAUX(threads);
+	TreeCopyTask<K, V>* tasks = new TreeCopyTask<K, V>[1 << depth];
+	int count = 0;
+	root = treeCopyAUX(tree.root, resource, depth - 1, tasks, &count);
+	treeRunTasksAUX(count, threads, [this, tasks](int i) {
+		Tnode<K, V>* copy = treeCopyAUX(tasks[i].src, resource);
+		copy->parent = tasks[i].dest_parent;
+		if (tasks[i].to_left) { //siblings write different fields of the parent, no race
+			tasks[i].dest_parent->left = copy;
+		}
+		else {
+			tasks[i].dest_parent->right = copy;
+		}
+	});
+	delete[] tasks;
+	size = tree.size;
+}
+
+/********************************** TREE RECLAIMER IMPLEMENTATION **********************************/
+template<class K, class V>
+void TreeReclaimer::reclaim(Tnode<K, V>* root, std::pmr::memory_resource* resource)
+{
+	Job* job = new Job;
+	job->root = root;
+	job->destroy = [](void* node, std::pmr::memory_resource* node_resource) {
+		treeDestructorAUX((Tnode<K, V>*)node, node_resource);
+	};
+	job->resource = resource;
+	std::lock_guard<std::mutex> guard(lock);
+	job->next = jobs;
+	jobs = job;
+	pending++;
+	wake.notify_all();
+}
+
+inline void TreeReclaimer::run()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		wake.wait(guard, [this] { return jobs != nullptr || stopping; });
+		if (jobs == nullptr) {
+			return; //stopping and nothing left
+		}
+		Job* taken = jobs;
+		jobs = nullptr;
+		guard.unlock();
+		int done = 0;
+		while (taken != nullptr) {
+			Job* next = taken->next;
+			taken->destroy(taken->root, taken->resource);
+			delete taken;
+			taken = next;
+			done++;
+		}
+		guard.lock();
+		pending -= done;
+		wake.notify_all();
+	}
+}
+
+inline TreeReclaimer::~TreeReclaimer()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+		wake.notify_all();
+	}
+	worker.join();
+}
+
+inline void TreeReclaimer::drain()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	wake.wait(guard, [this] { return pending == 0; });
+}
+
+inline int TreeReclaimer::getPending()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return pending;
+}
+
+/********************************** TREE SNAPSHOT IMPLEMENTATION **********************************/
+/*a tree node as stored in a snapshot file: children are indices into the node array (-1 = none)
+  nodes are stored in BFS order, so the root is node 0 and the top levels share pages*/
+template<class K, class V>
+struct SnapshotTnode {
+	K key;
+	V value;
+	int32_t left;
+	int32_t right;
+	int32_t height;
+};
+
+template<class K, class V, class S>
+bool AVLtree<K, V, S>::save(const char* path)
+{
+	static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+		"snapshot needs trivially copyable keys and values");
+	static_assert(alignof(SnapshotTnode<K, V>) <= alignof(SnapshotHeader), "node alignment not supported");
+	SnapshotTnode<K, V>* nodes = new SnapshotTnode<K, V>[size > 0 ? size : 1];
+	memset((void*)nodes, 0, sizeof(SnapshotTnode<K, V>) * (size > 0 ? size : 1)); //the padding is written to the file too
+	Tnode<K, V>** queue = new Tnode<K, V>*[size > 0 ? size : 1]; //BFS queue, queue[i] is saved as nodes[i]
+	int queue_tail = 0;
+	if (root != nullptr) {
+		queue[queue_tail++] = root;
+	}
+	for (int i = 0; i < queue_tail; i++) {
+		Tnode<K, V>* current = queue[i];
+		nodes[i].key = current->key;
+		nodes[i].value = current->value;
+		nodes[i].height = current->height;
+		nodes[i].left = -1;
+		nodes[i].right = -1;
+		if (current->left != nullptr) {
+			nodes[i].left = queue_tail;
+			queue[queue_tail++] = current->left;
+		}
+		if (current->right != nullptr) {
+			nodes[i].right = queue_tail;
+			queue[queue_tail++] = current->right;
+		}
+	}
+	SnapshotHeader header = makeSnapshotHeader(SnapshotType::AVL_TREE, sizeof(K), sizeof(V), queue_tail, 0);
+	bool ok = writeSnapshot(path, header, nodes, sizeof(SnapshotTnode<K, V>) * queue_tail, nullptr, 0);
+	delete[] queue;
+	delete[] nodes;
+	return ok;
+}
+
+/*returns false (and leaves the tree untouched) if the file is missing or isnt a matching snapshot*/
+template<class K, class V, class S>
+bool AVLtree<K, V, S>::load(const char* path)
+{
+	MappedFile file;
+	if (!file.open(path)) return false;
+	const SnapshotHeader* header = file.checkHeader(SnapshotType::AVL_TREE, sizeof(K), sizeof(V));
+	size_t remaining = file.getLength() - sizeof(SnapshotHeader);
+	if (header == nullptr || header->count > INT_MAX ||
+		!takeSnapshotRecords(remaining, header->count, sizeof(SnapshotTnode<K, V>))) {
+		return false;
+	}
+	const SnapshotTnode<K, V>* nodes = (const SnapshotTnode<K, V>*)(file.getData() + sizeof(SnapshotHeader));
+	int count = (int)header->count;
+	/*every node but the root must be the child of exactly one node that comes before it (BFS order),
+	  a node claimed twice would be freed twice and an unclaimed one would leak*/
+	bool* claimed = new bool[count > 0 ? count : 1]();
+	int links = 0;
+	bool valid = true;
+	for (int i = 0; i < count && valid; i++) {
+		int children[2] = { nodes[i].left, nodes[i].right };
+		for (int child : children) {
+			if (child == -1) continue;
+			if (child <= i || child >= count || claimed[child]) {
+				valid = false;
+				break;
+			}
+			claimed[child] = true;
+			links++;
+		}
+	}
+	delete[] claimed;
+	if (!valid || (count > 0 && links != count - 1)) {
+		return false;
+	}
+	Tnode<K, V>** created = new Tnode<K, V>*[count > 0 ? count : 1];
+	for (int i = 0; i < count; i++) {
+		created[i] = createObject<Tnode<K, V>>(resource, nodes[i].key, nodes[i].value);
+		created[i]->height = nodes[i].height;
+	}
+	for (int i = 0; i < count; i++) {
+		if (nodes[i].left != -1) {
+			created[i]->left = created[nodes[i].left];
+			created[nodes[i].left]->parent = created[i];
+		}
+		if (nodes[i].right != -1) {
+			created[i]->right = created[nodes[i].right];
+			created[nodes[i].right]->parent = created[i];
+		}
+	}
+	treeDestructorAUX(root, resource);
+	root = count > 0 ? created[0] : nullptr;
+	size = count;
+	delete[] created;
+	return true;
+}
+
+/*read only tree that works directly on a mapped snapshot file - loading is just mmap + header check
+  and the pages are shared between all processes that load the same file*/
+template<class K, class V>
+class AVLtreeView {
+	MappedFile file;
+	const SnapshotTnode<K, V>* nodes;
+	int size;
+
+public:
+	AVLtreeView() : nodes(nullptr), size(0) {}
+	AVLtreeView(const AVLtreeView<K, V>& view) = delete;
+	AVLtreeView<K, V>& operator=(const AVLtreeView<K, V>& view) = delete;
+	bool load(const char* path);
+	const V* find(const K& key) const; //nullptr if not found
+	int getSize() const {
+		return size;
+	}
+};
+
+template<class K, class V>
+bool AVLtreeView<K, V>::load(const char* path)
+{
+	nodes = nullptr;
+	size = 0;
+	if (!file.open(path)) return false;
+	const SnapshotHeader* header = file.checkHeader(SnapshotType::AVL_TREE, sizeof(K), sizeof(V));
+	size_t remaining = file.getLength() - sizeof(SnapshotHeader);
+	if (header == nullptr || header->count > INT_MAX ||
+		!takeSnapshotRecords(remaining, header->count, sizeof(SnapshotTnode<K, V>))) {
+		file.close();
+		return false;
+	}
+	nodes = (const SnapshotTnode<K, V>*)(file.getData() + sizeof(SnapshotHeader));
+	size = (int)header->count;
+	return true;
+}
+
+template<class K, class V>
+const V* AVLtreeView<K, V>::find(const K& key) const
+{
+	int current = size > 0 ? 0 : -1;
+	while (current >= 0 && current < size) {
+		if (key == nodes[current].key) return &nodes[current].value;
+		int next = (key > nodes[current].key) ? nodes[current].right : nodes[current].left;
+		if (next <= current) return nullptr; //children always come after their parent
+		current = next;
+	}
+	return nullptr;
 }
 
 #endif //AVLTREE_H
@@ -0,0 +1,609 @@
+#ifndef BPLUSTREE_H
+#define BPLUSTREE_H
+
+#include <iostream>
+#include <utility>
+#include "MemoryResource.h"
+
+/*cache conscious ordered map with the same insert/find/remove surface as AVLtree.
+* every node is NodeBytes long (default 4 cache lines) and keeps its keys in one contiguous array,
+* so a lookup costs ~log_B(n) cache misses instead of ~1.44*log2(n) for AVLtree.
+* all values live in the leaves and the leaves are linked to their siblings for range scans.
+* K must have operator< and operator==, K and V must be default constructible*/
+
+#define BTREE_MAX_DEPTH 32
+
+template<class K, class V, int NodeBytes = 256>
+class BPlusTree {
+	struct BNode {
+		bool is_leaf;
+		int count; //number of keys
+	};
+
+	/*how many (key, payload) pairs fit in a node after its header and two pointers, at least 4*/
+	static constexpr int capacity(int payload) {
+		return (NodeBytes - (int)(sizeof(BNode) + 2 * sizeof(void*))) / payload < 4 ?
+			4 : (NodeBytes - (int)(sizeof(BNode) + 2 * sizeof(void*))) / payload;
+	}
+
+public:
+	static constexpr int LEAF_CAPACITY = capacity((int)(sizeof(K) + sizeof(V)));
+	static constexpr int INNER_CAPACITY = capacity((int)(sizeof(K) + sizeof(void*)));
+
+private:
+	static constexpr int LEAF_MIN = LEAF_CAPACITY / 2;
+	static constexpr int INNER_MIN = INNER_CAPACITY / 2;
+
+	struct alignas(64) Leaf : BNode { //nodes start on a cache line
+		Leaf* prev; //sibling links
+		Leaf* next;
+		K keys[LEAF_CAPACITY];
+		V values[LEAF_CAPACITY];
+	};
+
+	/*keys[i] is the smallest key that can be found under children[i + 1]*/
+	struct alignas(64) Inner : BNode {
+		K keys[INNER_CAPACITY];
+		BNode* children[INNER_CAPACITY + 1];
+	};
+
+	BNode* root;
+	int size;
+	std::pmr::memory_resource* resource;
+
+	Leaf* createLeaf();
+	Inner* createInner();
+	void destroyNode(BNode* node);
+	void destroySubtree(BNode* node);
+	Leaf* descend(const K& key, Inner** path, int* child_index, int& depth);
+	void insertIntoParent(Inner** path, int* child_index, int depth, const K& separator, BNode* right);
+	void fixLeafUnderflow(Leaf* leaf, Inner** path, int* child_index, int depth);
+	void fixInnerUnderflow(Inner** path, int* child_index, int depth);
+	template<class KK, class VV>
+	V* insertAUX(KK&& key, VV&& value);
+
+	static int lowerBound(const K* keys, int count, const K& key) { //first index with keys[i] >= key
+		int low = 0, high = count;
+		while (low < high) {
+			int mid = (low + high) / 2;
+			if (keys[mid] < key) low = mid + 1;
+			else high = mid;
+		}
+		return low;
+	}
+	static int upperBound(const K* keys, int count, const K& key) { //first index with keys[i] > key
+		int low = 0, high = count;
+		while (low < high) {
+			int mid = (low + high) / 2;
+			if (key < keys[mid]) high = mid;
+			else low = mid + 1;
+		}
+		return low;
+	}
+
+public:
+	explicit BPlusTree(std::pmr::memory_resource* _resource = std::pmr::get_default_resource())
+		: root(nullptr), size(0), resource(_resource) {}
+	~BPlusTree();
+	BPlusTree(const BPlusTree<K, V, NodeBytes>& tree); //uses the default resource like the std::pmr containers
+	BPlusTree(BPlusTree<K, V, NodeBytes>&& tree); //takes tree's nodes and resource
+	BPlusTree<K, V, NodeBytes>& operator=(const BPlusTree<K, V, NodeBytes>& tree);
+	BPlusTree<K, V, NodeBytes>& operator=(BPlusTree<K, V, NodeBytes>&& tree);
+	int getSize();
+	V* find(const K& key); //nullptr if not found
+	V* insert(const K& key, const V& value); //returns the existing value if the key is already in the tree
+	V* insert(K&& key, V&& value); //key and value are left untouched if the key is already in the tree
+	bool remove(const K& key);
+	template<class F>
+	int scan(const K& from, int max_count, F visit); //calls visit(key, value) in order starting at from
+	void printInOrder();
+	void clear();
+};
+
+/*B+ TREE FUNCTION IMPLEMENTATIONS*/
+template<class K, class V, int NodeBytes>
+typename BPlusTree<K, V, NodeBytes>::Leaf* BPlusTree<K, V, NodeBytes>::createLeaf()
+{
+	Leaf* leaf = createObject<Leaf>(resource);
+	leaf->is_leaf = true;
+	leaf->count = 0;
+	leaf->prev = nullptr;
+	leaf->next = nullptr;
+	return leaf;
+}
+
+template<class K, class V, int NodeBytes>
+typename BPlusTree<K, V, NodeBytes>::Inner* BPlusTree<K, V, NodeBytes>::createInner()
+{
+	Inner* inner = createObject<Inner>(resource);
+	inner->is_leaf = false;
+	inner->count = 0;
+	return inner;
+}
+
+template<class K, class V, int NodeBytes>
+void BPlusTree<K, V, NodeBytes>::destroyNode(BNode* node)
+{
+	if (node->is_leaf) destroyObject(resource, static_cast<Leaf*>(node));
+	else destroyObject(resource, static_cast<Inner*>(node));
+}
+
+/*recursion depth is the height of the tree, which stays tiny (log_B(n))*/
+template<class K, class V, int NodeBytes>
+void BPlusTree<K, V, NodeBytes>::destroySubtree(BNode* node)
+{
+	if (!node->is_leaf) {
+		Inner* inner = static_cast<Inner*>(node);
+		for (int i = 0; i <= inner->count; i++) {
+			destroySubtree(inner->children[i]);
+		}
+	}
+	destroyNode(node);
+}
+
+template<class K, class V, int NodeBytes>
+void BPlusTree<K, V, NodeBytes>::clear()
+{
+	if (root != nullptr) {
+		destroySubtree(root);
+	}
+	root = nullptr;
+	size = 0;
+}
+
+template<class K, class V, int NodeBytes>
+BPlusTree<K, V, NodeBytes>::~BPlusTree()
+{
+	clear();
+}
+
+template<class K, class V, int NodeBytes>
+BPlusTree<K, V, NodeBytes>::BPlusTree(const BPlusTree<K, V, NodeBytes>& tree)
+	: root(nullptr), size(0), resource(std::pmr::get_default_resource())
+{
+	*this = tree;
+}
+
+/*the source's leaves are already sorted, so the copy is filled by walking them*/
+template<class K, class V, int NodeBytes>
+BPlusTree<K, V, NodeBytes>& BPlusTree<K, V, NodeBytes>::operator=(const BPlusTree<K, V, NodeBytes>& tree)
+{
+	if (this == &tree) {
+		return *this;
+	}
+	clear();
+	BNode* node = tree.root;
+	if (node == nullptr) return *this;
+	while (!node->is_leaf) {
+		node = static_cast<Inner*>(node)->children[0];
+	}
+	for (Leaf* leaf = static_cast<Leaf*>(node); leaf != nullptr; leaf = leaf->next) {
+		for (int i = 0; i < leaf->count; i++) {
+			insert(leaf->keys[i], leaf->values[i]);
+		}
+	}
+	return *this;
+}
+
+template<class K, class V, int NodeBytes>
+BPlusTree<K, V, NodeBytes>::BPlusTree(BPlusTree<K, V, NodeBytes>&& tree)
+	: root(tree.root), size(tree.size), resource(tree.resource)
+{
+	tree.root = nullptr;
+	tree.size = 0;
+}
+
+/*nodes can only be taken over from a tree of the same resource, otherwise the entries are moved one by one*/
+template<class K, class V, int NodeBytes>
+BPlusTree<K, V, NodeBytes>& BPlusTree<K, V, NodeBytes>::operator=(BPlusTree<K, V, NodeBytes>&& tree)
+{
+	if (this == &tree) {
+		return *this;
+	}
+	clear();
+	if (resource == tree.resource) {
+		root = tree.root;
+		size = tree.size;
+		tree.root = nullptr;
+		tree.size = 0;
+		return *this;
+	}
+	BNode* node = tree.root;
+	if (node != nullptr) {
+		while (!node->is_leaf) {
+			node = static_cast<Inner*>(node)->children[0];
+		}
+		for (Leaf* leaf = static_cast<Leaf*>(node); leaf != nullptr; leaf = leaf->next) {
+			for (int i = 0; i < leaf->count; i++) {
+				insert(std::move(leaf->keys[i]), std::move(leaf->values[i]));
+			}
+		}
+	}
+	tree.clear();
+	return *this;
+}
+
+template<class K, class V, int NodeBytes>
+int BPlusTree<K, V, NodeBytes>::getSize()
+{
+	return size;
+}
+
+/*walks from the root to the leaf that should hold key, remembering the inner nodes on the way
+  and which child was taken in each of them*/
+template<class K, class V, int NodeBytes>
+typename BPlusTree<K, V, NodeBytes>::Leaf* BPlusTree<K, V, NodeBytes>::descend(const K& key,
+	Inner** path, int* child_index, int& depth)
+{
+	depth = 0;
+	BNode* node = root;
+	while (!node->is_leaf) {
+		Inner* inner = static_cast<Inner*>(node);
+		int index = upperBound(inner->keys, inner->count, key);
+		if (path != nullptr) {
+			path[depth] = inner;
+			child_index[depth] = index;
+		}
+		depth++;
+		node = inner->children[index];
+	}
+	return static_cast<Leaf*>(node);
+}
+
+template<class K, class V, int NodeBytes>
+V* BPlusTree<K, V, NodeBytes>::find(const K& key)
+{
+	if (root == nullptr) return nullptr;
+	int depth;
+	Leaf* leaf = descend(key, nullptr, nullptr, depth);
+	int index = lowerBound(leaf->keys, leaf->count, key);
+	if (index < leaf->count && leaf->keys[index] == key) return &leaf->values[index];
+	return nullptr;
+}
+
+template<class K, class V, int NodeBytes>
+V* BPlusTree<K, V, NodeBytes>::insert(const K& key, const V& value)
+{
+	return insertAUX(key, value);
+}
+
+template<class K, class V, int NodeBytes>
+V* BPlusTree<K, V, NodeBytes>::insert(K&& key, V&& value)
+{
+	return insertAUX(std::move(key), std::move(value));
+}
+
+/*key is only moved into the leaf after the search is done with it*/
+template<class K, class V, int NodeBytes>
+template<class KK, class VV>
+V* BPlusTree<K, V, NodeBytes>::insertAUX(KK&& key, VV&& value)
+{
+	if (root == nullptr) {
+		Leaf* leaf = createLeaf();
+		leaf->keys[0] = std::forward<KK>(key);
+		leaf->values[0] = std::forward<VV>(value);
+		leaf->count = 1;
+		root = leaf;
+		size++;
+		return &leaf->values[0];
+	}
+	Inner* path[BTREE_MAX_DEPTH];
+	int child_index[BTREE_MAX_DEPTH];
+	int depth;
+	Leaf* leaf = descend(key, path, child_index, depth);
+	int index = lowerBound(leaf->keys, leaf->count, key);
+	if (index < leaf->count && leaf->keys[index] == key) { //key already exists
+		return &leaf->values[index];
+	}
+	size++;
+	if (leaf->count < LEAF_CAPACITY) {
+		for (int i = leaf->count; i > index; i--) {
+			leaf->keys[i] = std::move(leaf->keys[i - 1]);
+			leaf->values[i] = std::move(leaf->values[i - 1]);
+		}
+		leaf->keys[index] = std::forward<KK>(key);
+		leaf->values[index] = std::forward<VV>(value);
+		leaf->count++;
+		return &leaf->values[index];
+	}
+
+	//leaf is full - split it in half and link the new right leaf after it
+	Leaf* right = createLeaf();
+	int left_count = (LEAF_CAPACITY + 1) / 2;
+	int moved = LEAF_CAPACITY - left_count;
+	for (int i = 0; i < moved; i++) {
+		right->keys[i] = std::move(leaf->keys[left_count + i]);
+		right->values[i] = std::move(leaf->values[left_count + i]);
+	}
+	right->count = moved;
+	leaf->count = left_count;
+	right->next = leaf->next;
+	right->prev = leaf;
+	if (leaf->next != nullptr) {
+		leaf->next->prev = right;
+	}
+	leaf->next = right;
+
+	Leaf* target = leaf;
+	if (index > left_count) {
+		target = right;
+		index -= left_count;
+	}
+	for (int i = target->count; i > index; i--) {
+		target->keys[i] = std::move(target->keys[i - 1]);
+		target->values[i] = std::move(target->values[i - 1]);
+	}
+	target->keys[index] = std::forward<KK>(key);
+	target->values[index] = std::forward<VV>(value);
+	target->count++;
+	V* inserted = &target->values[index];
+	insertIntoParent(path, child_index, depth, right->keys[0], right);
+	return inserted;
+}
+
+/*adds (separator, right) right after the child that was split, splitting inner nodes up the path as needed*/
+template<class K, class V, int NodeBytes>
+void BPlusTree<K, V, NodeBytes>::insertIntoParent(Inner** path, int* child_index, int depth,
+	const K& separator, BNode* right)
+{
+	K key = separator;
+	for (int level = depth - 1; level >= 0; level--) {
+		Inner* parent = path[level];
+		int index = child_index[level];
+		if (parent->count < INNER_CAPACITY) {
+			for (int i = parent->count; i > index; i--) {
+				parent->keys[i] = std::move(parent->keys[i - 1]);
+				parent->children[i + 1] = parent->children[i];
+			}
+			parent->keys[index] = std::move(key);
+			parent->children[index + 1] = right;
+			parent->count++;
+			return;
+		}
+		//parent is full - build the overfull key/child arrays and split them around the middle key
+		K keys[INNER_CAPACITY + 1];
+		BNode* children[INNER_CAPACITY + 2];
+		for (int i = 0, j = 0; i <= INNER_CAPACITY; i++) {
+			if (i == index) {
+				keys[i] = std::move(key);
+			}
+			else {
+				keys[i] = std::move(parent->keys[j++]);
+			}
+		}
+		for (int i = 0, j = 0; i <= INNER_CAPACITY + 1; i++) {
+			if (i == index + 1) {
+				children[i] = right;
+			}
+			else {
+				children[i] = parent->children[j++];
+			}
+		}
+		int left_count = (INNER_CAPACITY + 1) / 2;
+		Inner* sibling = createInner();
+		parent->count = left_count;
+		for (int i = 0; i < left_count; i++) {
+			parent->keys[i] = std::move(keys[i]);
+			parent->children[i] = children[i];
+		}
+		parent->children[left_count] = children[left_count];
+		sibling->count = INNER_CAPACITY - left_count;
+		for (int i = 0; i < sibling->count; i++) {
+			sibling->keys[i] = std::move(keys[left_count + 1 + i]);
+			sibling->children[i] = children[left_count + 1 + i];
+		}
+		sibling->children[sibling->count] = children[INNER_CAPACITY + 1];
+		key = std::move(keys[left_count]); //the middle key moves up
+		right = sibling;
+	}
+	//the root was split - grow the tree by one level
+	Inner* new_root = createInner();
+	new_root->count = 1;
+	new_root->keys[0] = std::move(key);
+	new_root->children[0] = root;
+	new_root->children[1] = right;
+	root = new_root;
+}
+
+template<class K, class V, int NodeBytes>
+bool BPlusTree<K, V, NodeBytes>::remove(const K& key)
+{
+	if (root == nullptr) return false;
+	Inner* path[BTREE_MAX_DEPTH];
+	int child_index[BTREE_MAX_DEPTH];
+	int depth;
+	Leaf* leaf = descend(key, path, child_index, depth);
+	int index = lowerBound(leaf->keys, leaf->count, key);
+	if (index == leaf->count || !(leaf->keys[index] == key)) return false; //didnt find key in tree
+	for (int i = index; i < leaf->count - 1; i++) {
+		leaf->keys[i] = std::move(leaf->keys[i + 1]);
+		leaf->values[i] = std::move(leaf->values[i + 1]);
+	}
+	leaf->count--;
+	size--;
+	if (depth == 0) { //leaf is the root
+		if (leaf->count == 0) {
+			destroyNode(leaf);
+			root = nullptr;
+		}
+		return true;
+	}
+	if (leaf->count < LEAF_MIN) {
+		fixLeafUnderflow(leaf, path, child_index, depth);
+	}
+	return true;
+}
+
+/*borrows a key from a sibling leaf that has a spare one, otherwise merges with a sibling
+  (which removes a separator from the parent and may make the parent underflow in turn)*/
+template<class K, class V, int NodeBytes>
+void BPlusTree<K, V, NodeBytes>::fixLeafUnderflow(Leaf* leaf, Inner** path, int* child_index, int depth)
+{
+	Inner* parent = path[depth - 1];
+	int index = child_index[depth - 1];
+	Leaf* left = index > 0 ? static_cast<Leaf*>(parent->children[index - 1]) : nullptr;
+	Leaf* right = index < parent->count ? static_cast<Leaf*>(parent->children[index + 1]) : nullptr;
+
+	if (left != nullptr && left->count > LEAF_MIN) { //borrow the last key of the left sibling
+		for (int i = leaf->count; i > 0; i--) {
+			leaf->keys[i] = std::move(leaf->keys[i - 1]);
+			leaf->values[i] = std::move(leaf->values[i - 1]);
+		}
+		leaf->keys[0] = std::move(left->keys[left->count - 1]);
+		leaf->values[0] = std::move(left->values[left->count - 1]);
+		leaf->count++;
+		left->count--;
+		parent->keys[index - 1] = leaf->keys[0];
+		return;
+	}
+	if (right != nullptr && right->count > LEAF_MIN) { //borrow the first key of the right sibling
+		leaf->keys[leaf->count] = std::move(right->keys[0]);
+		leaf->values[leaf->count] = std::move(right->values[0]);
+		leaf->count++;
+		for (int i = 0; i < right->count - 1; i++) {
+			right->keys[i] = std::move(right->keys[i + 1]);
+			right->values[i] = std::move(right->values[i + 1]);
+		}
+		right->count--;
+		parent->keys[index] = right->keys[0];
+		return;
+	}
+
+	//merge - always into the left one of the pair, the right one is unlinked and deleted
+	Leaf* into = leaf;
+	Leaf* from = right;
+	int separator = index;
+	if (left != nullptr) {
+		into = left;
+		from = leaf;
+		separator = index - 1;
+	}
+	for (int i = 0; i < from->count; i++) {
+		into->keys[into->count + i] = std::move(from->keys[i]);
+		into->values[into->count + i] = std::move(from->values[i]);
+	}
+	into->count += from->count;
+	into->next = from->next;
+	if (from->next != nullptr) {
+		from->next->prev = into;
+	}
+	destroyNode(from);
+	for (int i = separator; i < parent->count - 1; i++) {
+		parent->keys[i] = std::move(parent->keys[i + 1]);
+		parent->children[i + 1] = parent->children[i + 2];
+	}
+	parent->count--;
+	fixInnerUnderflow(path, child_index, depth - 1);
+}
+
+/*same idea as fixLeafUnderflow for the inner node path[level], keys are rotated through the parent*/
+template<class K, class V, int NodeBytes>
+void BPlusTree<K, V, NodeBytes>::fixInnerUnderflow(Inner** path, int* child_index, int level)
+{
+	while (true) {
+		Inner* node = path[level];
+		if (level == 0) { //node is the root
+			if (node->count == 0) { //shrink the tree by one level
+				root = node->children[0];
+				destroyNode(node);
+			}
+			return;
+		}
+		if (node->count >= INNER_MIN) return;
+
+		Inner* parent = path[level - 1];
+		int index = child_index[level - 1];
+		Inner* left = index > 0 ? static_cast<Inner*>(parent->children[index - 1]) : nullptr;
+		Inner* right = index < parent->count ? static_cast<Inner*>(parent->children[index + 1]) : nullptr;
+
+		if (left != nullptr && left->count > INNER_MIN) {
+			for (int i = node->count; i > 0; i--) {
+				node->keys[i] = std::move(node->keys[i - 1]);
+			}
+			for (int i = node->count + 1; i > 0; i--) {
+				node->children[i] = node->children[i - 1];
+			}
+			node->keys[0] = std::move(parent->keys[index - 1]);
+			node->children[0] = left->children[left->count];
+			parent->keys[index - 1] = std::move(left->keys[left->count - 1]);
+			left->count--;
+			node->count++;
+			return;
+		}
+		if (right != nullptr && right->count > INNER_MIN) {
+			node->keys[node->count] = std::move(parent->keys[index]);
+			node->children[node->count + 1] = right->children[0];
+			parent->keys[index] = std::move(right->keys[0]);
+			for (int i = 0; i < right->count - 1; i++) {
+				right->keys[i] = std::move(right->keys[i + 1]);
+			}
+			for (int i = 0; i < right->count; i++) {
+				right->children[i] = right->children[i + 1];
+			}
+			right->count--;
+			node->count++;
+			return;
+		}
+
+		Inner* into = node;
+		Inner* from = right;
+		int separator = index;
+		if (left != nullptr) {
+			into = left;
+			from = node;
+			separator = index - 1;
+		}
+		into->keys[into->count] = std::move(parent->keys[separator]); //the separator comes down between the two
+		for (int i = 0; i < from->count; i++) {
+			into->keys[into->count + 1 + i] = std::move(from->keys[i]);
+		}
+		for (int i = 0; i <= from->count; i++) {
+			into->children[into->count + 1 + i] = from->children[i];
+		}
+		into->count += from->count + 1;
+		destroyNode(from);
+		for (int i = separator; i < parent->count - 1; i++) {
+			parent->keys[i] = std::move(parent->keys[i + 1]);
+			parent->children[i + 1] = parent->children[i + 2];
+		}
+		parent->count--;
+		level--;
+	}
+}
+
+/*starts at the first key >= from and follows the leaf links, returns the number of visited keys*/
+template<class K, class V, int NodeBytes>
+template<class F>
+int BPlusTree<K, V, NodeBytes>::scan(const K& from, int max_count, F visit)
+{
+	if (root == nullptr) return 0;
+	int depth;
+	Leaf* leaf = descend(from, nullptr, nullptr, depth);
+	int index = lowerBound(leaf->keys, leaf->count, from);
+	int visited = 0;
+	while (leaf != nullptr && visited < max_count) {
+		for (; index < leaf->count && visited < max_count; index++, visited++) {
+			visit(leaf->keys[index], leaf->values[index]);
+		}
+		leaf = leaf->next;
+		index = 0;
+	}
+	return visited;
+}
+
+template<class K, class V, int NodeBytes>
+void BPlusTree<K, V, NodeBytes>::printInOrder()
+{
+	if (root == nullptr) return;
+	BNode* node = root;
+	while (!node->is_leaf) {
+		node = static_cast<Inner*>(node)->children[0];
+	}
+	for (Leaf* leaf = static_cast<Leaf*>(node); leaf != nullptr; leaf = leaf->next) {
+		for (int i = 0; i < leaf->count; i++) {
+			std::cout << leaf->keys[i] << " ";
+		}
+	}
+}
+
+#endif //BPLUSTREE_H
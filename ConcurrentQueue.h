@@ -0,0 +1,217 @@
+#ifndef CONCURRENT_QUEUE_H
+#define CONCURRENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CACHE_LINE
+#define CACHE_LINE 64
+#endif
+
+/*lock free replacements for List::push_front/pop_front used as a work queue between threads
+* MPSCQueue: unbounded intrusive queue (Vyukov) - any number of producers, a single consumer.
+*            it moves the caller's nodes the same way push_front/pop_front do, so it never allocates
+* MPMCQueue: bounded ring buffer (Vyukov) - any number of producers and consumers.
+*            all the cells are allocated once in the constructor*/
+
+/********************************** QUEUE NODE IMPLEMENTATION **********************************/
+template<class D>
+class QueueNode {
+public:
+	std::atomic<QueueNode*> next;
+	D data;
+
+	QueueNode() : next(nullptr), data() {}
+	explicit QueueNode(const D& _data) : next(nullptr), data(_data) {}
+
+	QueueNode(const QueueNode<D>& node) = delete; //a linked node must not be duplicated
+	QueueNode<D>& operator=(const QueueNode<D>& node) = delete;
+};
+
+/**********************************MPSC QUEUE IMPLEMENTATION **********************************/
+template<class D>
+class MPSCQueue {
+	alignas(CACHE_LINE) std::atomic<QueueNode<D>*> head; //producers push here
+	alignas(CACHE_LINE) QueueNode<D>* tail; //only touched by the consumer
+	QueueNode<D> stub; //dummy node, same idea as the dummy nodes of List
+
+public:
+	MPSCQueue();
+	MPSCQueue(const MPSCQueue<D>& queue) = delete;
+	MPSCQueue<D>& operator=(const MPSCQueue<D>& queue) = delete;
+	void push(QueueNode<D>* node); //safe from any thread, pushes an already existing node (doesnt create new node)
+	QueueNode<D>* pop(); //consumer only, pops without deleting, nullptr if empty
+	int popBatch(QueueNode<D>** out, int max); //consumer only, returns number of popped nodes
+	bool isEmpty(); //consumer only
+};
+
+template<class D>
+MPSCQueue<D>::MPSCQueue() : head(&stub), tail(&stub) {}
+
+template<class D>
+void MPSCQueue<D>::push(QueueNode<D>* node)
+{
+	node->next.store(nullptr, std::memory_order_relaxed);
+	QueueNode<D>* prev = head.exchange(node, std::memory_order_acq_rel);
+	prev->next.store(node, std::memory_order_release); //until this store the node is not visible to the consumer
+}
+
+/*returns nullptr if the queue is empty or if a producer is in the middle of a push
+  the returned node belongs to the caller again and can be reused for another push*/
+template<class D>
+QueueNode<D>* MPSCQueue<D>::pop()
+{
+	QueueNode<D>* current = tail;
+	QueueNode<D>* next = current->next.load(std::memory_order_acquire);
+	if (current == &stub) { //skip the dummy node
+		if (next == nullptr) return nullptr;
+		tail = next;
+		current = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+	if (next != nullptr) {
+		tail = next;
+		return current;
+	}
+	if (current != head.load(std::memory_order_acquire)) {
+		return nullptr; //a producer swapped head but didnt link it yet
+	}
+	push(&stub); //current is the last node, put the dummy behind it so it can be popped
+	next = current->next.load(std::memory_order_acquire);
+	if (next != nullptr) {
+		tail = next;
+		return current;
+	}
+	return nullptr;
+}
+
+template<class D>
+int MPSCQueue<D>::popBatch(QueueNode<D>** out, int max)
+{
+	int count = 0;
+	while (count < max) {
+		QueueNode<D>* node = pop();
+		if (node == nullptr) break;
+		out[count++] = node;
+	}
+	return count;
+}
+
+template<class D>
+bool MPSCQueue<D>::isEmpty()
+{
+	return tail == &stub && stub.next.load(std::memory_order_acquire) == nullptr;
+}
+
+/**********************************MPMC QUEUE IMPLEMENTATION **********************************/
+template<class D>
+class MPMCQueue {
+	struct Cell {
+		std::atomic<size_t> sequence;
+		D data;
+	};
+
+	Cell* buffer;
+	size_t mask; //capacity is a power of two so the index is pos & mask
+	alignas(CACHE_LINE) std::atomic<size_t> enqueue_pos;
+	alignas(CACHE_LINE) std::atomic<size_t> dequeue_pos;
+
+public:
+	explicit MPMCQueue(size_t capacity); //rounded up to a power of two
+	~MPMCQueue();
+	MPMCQueue(const MPMCQueue<D>& queue) = delete;
+	MPMCQueue<D>& operator=(const MPMCQueue<D>& queue) = delete;
+	bool enqueue(const D& data); //returns false if the queue is full
+	bool dequeue(D& data); //returns false if the queue is empty
+	int dequeueBatch(D* out, int max); //returns number of dequeued elements
+	size_t getCapacity();
+};
+
+template<class D>
+MPMCQueue<D>::MPMCQueue(size_t capacity) : enqueue_pos(0), dequeue_pos(0)
+{
+	size_t size = 2;
+	while (size < capacity) {
+		size *= 2;
+	}
+	buffer = new Cell[size];
+	mask = size - 1;
+	for (size_t i = 0; i < size; i++) {
+		buffer[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+template<class D>
+MPMCQueue<D>::~MPMCQueue()
+{
+	delete[] buffer;
+}
+
+/*a cell is free for the producer at pos when its sequence == pos,
+  and holds data for the consumer at pos when its sequence == pos + 1*/
+template<class D>
+bool MPMCQueue<D>::enqueue(const D& data)
+{
+	Cell* cell;
+	size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+	while (true) {
+		cell = &buffer[pos & mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0) {
+			return false; //full
+		}
+		else {
+			pos = enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+	cell->data = data;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+template<class D>
+bool MPMCQueue<D>::dequeue(D& data)
+{
+	Cell* cell;
+	size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+	while (true) {
+		cell = &buffer[pos & mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+		if (diff == 0) {
+			if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0) {
+			return false; //empty
+		}
+		else {
+			pos = dequeue_pos.load(std::memory_order_relaxed);
+		}
+	}
+	data = cell->data;
+	cell->sequence.store(pos + mask + 1, std::memory_order_release); //free for the next round
+	return true;
+}
+
+template<class D>
+int MPMCQueue<D>::dequeueBatch(D* out, int max)
+{
+	int count = 0;
+	while (count < max && dequeue(out[count])) {
+		count++;
+	}
+	return count;
+}
+
+template<class D>
+size_t MPMCQueue<D>::getCapacity()
+{
+	return mask + 1;
+}
+
+#endif // !CONCURRENT_QUEUE_H
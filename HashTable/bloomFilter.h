@@ -0,0 +1,119 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <cstdint>
+#include "../MemoryResource.h"
+
+/*blocked bloom filter over int keys - every key maps to one 64 byte block (one cache line)
+* and sets one bit in each of the block's 8 words, so a lookup touches a single cache line and
+* the 8 word tests are independent (the loop vectorizes). bits can not be cleared, so removed
+* keys stay in the filter until it is rebuilt*/
+
+struct alignas(64) BloomBlock {
+    uint64_t words[8];
+};
+
+class BloomFilter {
+    BloomBlock* blocks;
+    uint32_t block_count;
+    int added;
+    std::pmr::memory_resource* resource;
+
+    static uint64_t mix(int key) {
+        uint64_t h = (uint64_t)(uint32_t)key * 0x9e3779b97f4a7c15ULL;
+        return h ^ (h >> 29);
+    }
+    BloomBlock& blockOf(uint64_t h) const { //high 32 bits pick the block without a modulo
+        return blocks[((h >> 32) * block_count) >> 32];
+    }
+    static uint64_t bitOf(uint64_t h, int word) {
+        static const uint32_t salt[8] = { 0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                          0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+        return 1ULL << (((uint32_t)h * salt[word]) >> 26);
+    }
+
+public:
+    BloomFilter(int expected_keys, int bits_per_key,
+        std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+    ~BloomFilter();
+    BloomFilter(const BloomFilter& filter) = delete;
+    BloomFilter& operator=(const BloomFilter& filter) = delete;
+    void add(int key);
+    bool mayContain(int key) const; //false means the key was never added
+    void clear();
+    double estimateFalsePositiveRate() const; //from the fraction of set bits
+    int getAdded() const {
+        return added;
+    }
+    uint32_t getBlockCount() const {
+        return block_count;
+    }
+};
+
+inline BloomFilter::BloomFilter(int expected_keys, int bits_per_key, std::pmr::memory_resource* _resource)
+    : added(0), resource(_resource)
+{
+    uint64_t bits = (uint64_t)(expected_keys > 0 ? expected_keys : 1) * (bits_per_key > 0 ? bits_per_key : 1);
+    block_count = (uint32_t)((bits + 511) / 512);
+    blocks = allocateArray<BloomBlock>(resource, block_count);
+    clear();
+}
+
+inline BloomFilter::~BloomFilter()
+{
+    deallocateArray(resource, blocks, block_count);
+}
+
+inline void BloomFilter::add(int key)
+{
+    uint64_t h = mix(key);
+    BloomBlock& block = blockOf(h);
+    for (int i = 0; i < 8; i++) {
+        block.words[i] |= bitOf(h, i);
+    }
+    added++;
+}
+
+inline bool BloomFilter::mayContain(int key) const
+{
+    uint64_t h = mix(key);
+    const BloomBlock& block = blockOf(h);
+    uint64_t missing = 0;
+    for (int i = 0; i < 8; i++) { //no early exit, all 8 words are in the same line anyway
+        missing |= ~block.words[i] & bitOf(h, i);
+    }
+    return missing == 0;
+}
+
+inline void BloomFilter::clear()
+{
+    for (uint32_t i = 0; i < block_count; i++) {
+        for (int j = 0; j < 8; j++) {
+            blocks[i].words[j] = 0;
+        }
+    }
+    added = 0;
+}
+
+/*a random absent key passes if its bit is set in all 8 words - about fill^8 where fill is
+  the fraction of set bits (blocks are filled unevenly so the real rate is a bit higher)*/
+inline double BloomFilter::estimateFalsePositiveRate() const
+{
+    uint64_t set = 0;
+    for (uint32_t i = 0; i < block_count; i++) {
+        for (int j = 0; j < 8; j++) {
+            uint64_t w = blocks[i].words[j];
+            for (; w != 0; w &= w - 1) {
+                set++;
+            }
+        }
+    }
+    double fill = (double)set / ((double)block_count * 512);
+    double rate = 1;
+    for (int i = 0; i < 8; i++) {
+        rate *= fill;
+    }
+    return rate;
+}
+
+#endif // !BLOOM_FILTER_H
@@ -0,0 +1,531 @@
+#ifndef CUCKOO_HASHTABLE_H
+#define CUCKOO_HASHTABLE_H
+
+#include <cstdint>
+#include <new>
+#include <utility>
+#include "../MemoryResource.h"
+#define CUCKOO_WAYS 4 //slots per bucket
+#define CUCKOO_STASH 8 //elements that found no slot, searched after both buckets
+#define CUCKOO_SEARCH 256 //buckets the insertion search visits before it falls back to the stash
+#define CUCKOO_MIN_BUCKETS 4
+#define CUCKOO_KEY_LIMIT (2 * CUCKOO_WAYS + CUCKOO_STASH) //distinct elements one key can hold, see place
+
+#ifndef CACHE_LINE
+#define CACHE_LINE 64
+#endif
+
+/* bucketized cuckoo HashTable for lookups with a bounded worst case - every key has exactly two buckets of
+* CUCKOO_WAYS slots, so a find checks two buckets (two cache lines when a bucket fits one) and a small stash,
+* never a chain. same element requirements as HashTable (operator() returns the key, operator== compares):
+* buckets: the keys sit in front of the elements, so slots with another key are skipped without touching
+*          the element. the bucket count is a power of two and both bucket indexes come from one 64 bit
+*          mix of the key (negative keys are fine, unlike HashTable's modulo)
+* insert: takes a free slot in either bucket, otherwise searches breadth first (up to CUCKOO_SEARCH buckets)
+*         for the shortest chain of elements that can each move to their other bucket and shifts them
+*         along it. when no chain exists the element goes to the stash, and a full stash doubles the table.
+*         elements that share a key share both buckets at every size, so one key holds at most
+*         CUCKOO_KEY_LIMIT distinct elements (both buckets and the whole stash) - insert returns nullptr past
+*         that, where HashTable would just make the chain longer
+* with 4 slots per bucket the table fills past 95% before an insert needs the stash.
+* inserts move elements between slots, so the pointers find/insert return are only valid until the next
+* insert or remove. not synchronized*/
+template<class T>
+class CuckooHashTable {
+    struct alignas(CACHE_LINE) Bucket {
+        int keys[CUCKOO_WAYS];
+        uint8_t used; //bit i set = slot i holds an element
+        alignas(T) unsigned char slots[CUCKOO_WAYS][sizeof(T)];
+
+        T* at(int i) {
+            return std::launder(reinterpret_cast<T*>(slots[i]));
+        }
+    };
+
+    /*one bucket visited by the insertion search*/
+    struct Step {
+        int bucket;
+        int parent; //step the element came from, -1 for the new key's own buckets
+        int parent_slot; //slot of that element in the parent's bucket
+    };
+
+    Bucket* buckets;
+    int bucket_count;
+    int count;
+    int stash_keys[CUCKOO_STASH];
+    alignas(T) unsigned char stash[CUCKOO_STASH][sizeof(T)];
+    int stash_count; //the stash is always packed at the front
+    std::pmr::memory_resource* resource;
+
+    void bucketsOf(int key, int& first, int& second) const;
+    int otherBucket(int key, int bucket) const {
+        int first, second;
+        bucketsOf(key, first, second);
+        return bucket == first ? second : first;
+    }
+    T* stashAt(int i) {
+        return std::launder(reinterpret_cast<T*>(stash[i]));
+    }
+    Bucket* createBuckets(int n);
+    void destroyBuckets(Bucket* arr, int n);
+    int freeSlot(int bucket) const; //-1 if the bucket is full
+    bool findSlot(const T& element, int key, int& bucket, int& slot); //bucket -1 = stash
+    int makeRoom(int first, int second, int& bucket); //slot freed in first or second by shifting, -1 if none
+    int keyCount(int key) const; //elements stored under key
+    T* place(T&& element, int key); //element must not exist yet, nullptr if key is full
+    void grow(); //doubles the buckets and places every element again
+    void unstash(); //moves stashed elements to buckets that have room now
+
+public:
+    explicit CuckooHashTable(std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+    CuckooHashTable(int _size, std::pmr::memory_resource* _resource = std::pmr::get_default_resource()); //room for _size elements
+    CuckooHashTable(const CuckooHashTable<T>& table) = delete;
+    CuckooHashTable(CuckooHashTable<T>&& table); //takes table's buckets and resource, table is left empty
+    ~CuckooHashTable();
+    CuckooHashTable<T>& operator=(const CuckooHashTable<T>& table) = delete;
+    CuckooHashTable<T>& operator=(CuckooHashTable<T>&& table);
+
+    T* insert(T* element, int key) { //nullptr if the element already exists or its key is full
+        return insert(*static_cast<const T*>(element), key);
+    }
+    T* insert(const T& element, int key);
+    T* insert(T&& element, int key);
+    template<class... Args>
+    T* emplace(int key, Args&&... args);
+    bool remove(T* element, int key) { //false if not found
+        return remove(*static_cast<const T*>(element), key);
+    }
+    bool remove(const T& element, int key);
+    T* find(T* element, int key) {
+        return find(*static_cast<const T*>(element), key);
+    }
+    T* find(const T& element, int key);
+    void clear();
+    int getSize() const { //number of buckets, like HashTable::getSize
+        return bucket_count;
+    }
+    int getCount() const {
+        return count;
+    }
+    int getCapacity() const {
+        return bucket_count * CUCKOO_WAYS;
+    }
+    double getLoadFactor() const { //elements per slot
+        return (double)count / getCapacity();
+    }
+    int getStashCount() const {
+        return stash_count;
+    }
+    std::pmr::memory_resource* getResource() const {
+        return resource;
+    }
+};
+
+/***********************FUNCTION IMPLEMENTATIONS*******************/
+template<class T>
+CuckooHashTable<T>::CuckooHashTable(std::pmr::memory_resource* _resource)
+    : buckets(nullptr), bucket_count(CUCKOO_MIN_BUCKETS), count(0), stash_count(0), resource(_resource)
+{
+    buckets = createBuckets(bucket_count);
+}
+
+template<class T>
+CuckooHashTable<T>::CuckooHashTable(int _size, std::pmr::memory_resource* _resource)
+    : buckets(nullptr), bucket_count(CUCKOO_MIN_BUCKETS), count(0), stash_count(0), resource(_resource)
+{
+    while ((long long)bucket_count * CUCKOO_WAYS * 9 < (long long)_size * 10) { //leaves 10% free for the search
+        bucket_count *= 2;
+    }
+    buckets = createBuckets(bucket_count);
+}
+
+template<class T>
+CuckooHashTable<T>::CuckooHashTable(CuckooHashTable<T>&& table)
+    : buckets(table.buckets), bucket_count(table.bucket_count), count(table.count), stash_count(0), resource(table.resource)
+{
+    for (int i = 0; i < table.stash_count; i++) {
+        stash_keys[i] = table.stash_keys[i];
+        new (stash[i]) T(std::move(*table.stashAt(i)));
+        table.stashAt(i)->~T();
+    }
+    stash_count = table.stash_count;
+    table.bucket_count = CUCKOO_MIN_BUCKETS;
+    table.buckets = table.createBuckets(table.bucket_count);
+    table.count = 0;
+    table.stash_count = 0;
+}
+
+template<class T>
+CuckooHashTable<T>::~CuckooHashTable()
+{
+    clear();
+    destroyBuckets(buckets, bucket_count);
+}
+
+/*like HashTable's, the elements are moved one by one when the resources differ*/
+template<class T>
+CuckooHashTable<T>& CuckooHashTable<T>::operator=(CuckooHashTable<T>&& table)
+{
+    if (this == &table) {
+        return *this;
+    }
+    clear();
+    if (resource != table.resource) {
+        for (int b = 0; b < table.bucket_count; b++) {
+            Bucket& bucket = table.buckets[b];
+            for (int i = 0; i < CUCKOO_WAYS; i++) {
+                if (bucket.used & (1 << i)) {
+                    insert(std::move(*bucket.at(i)), bucket.keys[i]);
+                }
+            }
+        }
+        for (int i = 0; i < table.stash_count; i++) {
+            insert(std::move(*table.stashAt(i)), table.stash_keys[i]);
+        }
+        table.clear();
+        return *this;
+    }
+    std::swap(buckets, table.buckets);
+    std::swap(bucket_count, table.bucket_count);
+    count = table.count;
+    for (int i = 0; i < table.stash_count; i++) {
+        stash_keys[i] = table.stash_keys[i];
+        new (stash[i]) T(std::move(*table.stashAt(i)));
+        table.stashAt(i)->~T();
+    }
+    stash_count = table.stash_count;
+    table.count = 0;
+    table.stash_count = 0; //table now holds this table's old (empty) buckets
+    return *this;
+}
+
+/*a single multiply and xor-shift mix, the low half picks the first bucket and the high half the second.
+  two different buckets are guaranteed, otherwise the key would have only one*/
+template<class T>
+void CuckooHashTable<T>::bucketsOf(int key, int& first, int& second) const
+{
+    uint64_t h = (uint64_t)(uint32_t)key * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 32;
+    int mask = bucket_count - 1;
+    first = (int)h & mask;
+    second = (int)(h >> 32) & mask;
+    if (second == first) {
+        second = first ^ 1;
+    }
+}
+
+template<class T>
+typename CuckooHashTable<T>::Bucket* CuckooHashTable<T>::createBuckets(int n)
+{
+    Bucket* arr = allocateArray<Bucket>(resource, n);
+    for (int i = 0; i < n; i++) {
+        arr[i].used = 0;
+    }
+    return arr;
+}
+
+/*the elements must be destroyed already*/
+template<class T>
+void CuckooHashTable<T>::destroyBuckets(Bucket* arr, int n)
+{
+    deallocateArray(resource, arr, n);
+}
+
+template<class T>
+int CuckooHashTable<T>::freeSlot(int bucket) const
+{
+    uint8_t used = buckets[bucket].used;
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        if (!(used & (1 << i))) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+template<class T>
+bool CuckooHashTable<T>::findSlot(const T& element, int key, int& bucket, int& slot)
+{
+    int candidates[2];
+    bucketsOf(key, candidates[0], candidates[1]);
+    for (int c = 0; c < 2; c++) {
+        Bucket& current = buckets[candidates[c]];
+        for (int i = 0; i < CUCKOO_WAYS; i++) {
+            if ((current.used & (1 << i)) && current.keys[i] == key && *current.at(i) == element) {
+                bucket = candidates[c];
+                slot = i;
+                return true;
+            }
+        }
+    }
+    for (int i = 0; i < stash_count; i++) {
+        if (stash_keys[i] == key && *stashAt(i) == element) {
+            bucket = -1;
+            slot = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class T>
+T* CuckooHashTable<T>::find(const T& element, int key)
+{
+    int bucket, slot;
+    if (!findSlot(element, key, bucket, slot)) {
+        return nullptr;
+    }
+    return bucket < 0 ? stashAt(slot) : buckets[bucket].at(slot);
+}
+
+/*breadth first, so the chain found is the shortest and moves the fewest elements. a bucket already on the
+  chain is not visited again through it - an element would otherwise be moved twice. the elements are shifted
+  from the end of the chain back, each into the slot the previous shift emptied*/
+template<class T>
+int CuckooHashTable<T>::makeRoom(int first, int second, int& bucket)
+{
+    Step steps[CUCKOO_SEARCH];
+    steps[0] = { first, -1, -1 };
+    steps[1] = { second, -1, -1 };
+    int visited = 2;
+    for (int head = 0; head < visited; head++) {
+        Bucket& current = buckets[steps[head].bucket];
+        for (int i = 0; i < CUCKOO_WAYS; i++) {
+            int next = otherBucket(current.keys[i], steps[head].bucket);
+            bool on_chain = false;
+            for (int s = head; s >= 0 && !on_chain; s = steps[s].parent) {
+                on_chain = steps[s].bucket == next;
+            }
+            if (on_chain) {
+                continue;
+            }
+            int free_slot = freeSlot(next);
+            if (free_slot < 0) {
+                if (visited < CUCKOO_SEARCH) {
+                    steps[visited++] = { next, head, i };
+                }
+                continue;
+            }
+            int step = head;
+            int from = i;
+            while (true) {
+                Bucket& source = buckets[steps[step].bucket];
+                Bucket& target = buckets[next];
+                new (target.slots[free_slot]) T(std::move(*source.at(from)));
+                source.at(from)->~T();
+                target.keys[free_slot] = source.keys[from];
+                target.used |= (uint8_t)(1 << free_slot);
+                source.used &= (uint8_t)~(1 << from);
+                if (steps[step].parent < 0) {
+                    bucket = steps[step].bucket;
+                    return from;
+                }
+                next = steps[step].bucket;
+                free_slot = from;
+                from = steps[step].parent_slot;
+                step = steps[step].parent;
+            }
+        }
+    }
+    return -1;
+}
+
+template<class T>
+int CuckooHashTable<T>::keyCount(int key) const
+{
+    int first, second;
+    bucketsOf(key, first, second);
+    int found = 0;
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        found += (buckets[first].used & (1 << i)) && buckets[first].keys[i] == key;
+        found += (buckets[second].used & (1 << i)) && buckets[second].keys[i] == key;
+    }
+    for (int i = 0; i < stash_count; i++) {
+        found += stash_keys[i] == key;
+    }
+    return found;
+}
+
+/*growing cant separate elements with the same key, so once the key fills both buckets and the stash
+  another grow would never end - the insert fails instead and element is left untouched. grow itself
+  only places elements that fit before, so it never hits the limit*/
+template<class T>
+T* CuckooHashTable<T>::place(T&& element, int key)
+{
+    while (true) {
+        int first, second;
+        bucketsOf(key, first, second);
+        int bucket = first;
+        int slot = freeSlot(first);
+        if (slot < 0) {
+            bucket = second;
+            slot = freeSlot(second);
+        }
+        if (slot < 0) {
+            slot = makeRoom(first, second, bucket);
+        }
+        if (slot >= 0) {
+            Bucket& target = buckets[bucket];
+            T* placed = new (target.slots[slot]) T(std::move(element));
+            target.keys[slot] = key;
+            target.used |= (uint8_t)(1 << slot);
+            count++;
+            return placed;
+        }
+        if (stash_count < CUCKOO_STASH) {
+            stash_keys[stash_count] = key;
+            T* placed = new (stash[stash_count]) T(std::move(element));
+            stash_count++;
+            count++;
+            return placed;
+        }
+        if (keyCount(key) >= CUCKOO_KEY_LIMIT) {
+            return nullptr;
+        }
+        grow();
+    }
+}
+
+/*the old stash is emptied first, its elements may fit in the bigger buckets*/
+template<class T>
+void CuckooHashTable<T>::grow()
+{
+    Bucket* old = buckets;
+    int old_count = bucket_count;
+    int saved_count = stash_count;
+    int saved_keys[CUCKOO_STASH];
+    alignas(T) unsigned char saved[CUCKOO_STASH][sizeof(T)];
+    for (int i = 0; i < saved_count; i++) {
+        saved_keys[i] = stash_keys[i];
+        new (saved[i]) T(std::move(*stashAt(i)));
+        stashAt(i)->~T();
+    }
+    stash_count = 0;
+    bucket_count *= 2;
+    buckets = createBuckets(bucket_count);
+    count = 0;
+    for (int b = 0; b < old_count; b++) {
+        for (int i = 0; i < CUCKOO_WAYS; i++) {
+            if (old[b].used & (1 << i)) {
+                place(std::move(*old[b].at(i)), old[b].keys[i]); //may grow again, old is still ours
+                old[b].at(i)->~T();
+            }
+        }
+    }
+    for (int i = 0; i < saved_count; i++) {
+        T* element = std::launder(reinterpret_cast<T*>(saved[i]));
+        place(std::move(*element), saved_keys[i]);
+        element->~T();
+    }
+    destroyBuckets(old, old_count);
+}
+
+template<class T>
+T* CuckooHashTable<T>::insert(const T& element, int key)
+{
+    int bucket, slot;
+    if (findSlot(element, key, bucket, slot)) {
+        return nullptr;
+    }
+    T copy(element);
+    return place(std::move(copy), key);
+}
+
+template<class T>
+T* CuckooHashTable<T>::insert(T&& element, int key)
+{
+    int bucket, slot;
+    if (findSlot(element, key, bucket, slot)) {
+        return nullptr; //element is left untouched
+    }
+    return place(std::move(element), key);
+}
+
+/*the element has to exist before it can be compared, so it is built first and dropped if it is a duplicate*/
+template<class T>
+template<class... Args>
+T* CuckooHashTable<T>::emplace(int key, Args&&... args)
+{
+    T element(std::forward<Args>(args)...);
+    return insert(std::move(element), key);
+}
+
+template<class T>
+bool CuckooHashTable<T>::remove(const T& element, int key)
+{
+    int bucket, slot;
+    if (!findSlot(element, key, bucket, slot)) {
+        return false;
+    }
+    count--;
+    if (bucket < 0) {
+        stashAt(slot)->~T();
+        stash_count--;
+        if (slot != stash_count) { //keeps the stash packed
+            stash_keys[slot] = stash_keys[stash_count];
+            new (stash[slot]) T(std::move(*stashAt(stash_count)));
+            stashAt(stash_count)->~T();
+        }
+        return true;
+    }
+    buckets[bucket].at(slot)->~T();
+    buckets[bucket].used &= (uint8_t)~(1 << slot);
+    if (stash_count > 0) {
+        unstash();
+    }
+    return true;
+}
+
+template<class T>
+void CuckooHashTable<T>::unstash()
+{
+    int i = 0;
+    while (i < stash_count) {
+        int first, second;
+        bucketsOf(stash_keys[i], first, second);
+        int bucket = first;
+        int slot = freeSlot(first);
+        if (slot < 0) {
+            bucket = second;
+            slot = freeSlot(second);
+        }
+        if (slot < 0) {
+            i++;
+            continue;
+        }
+        Bucket& target = buckets[bucket];
+        new (target.slots[slot]) T(std::move(*stashAt(i)));
+        stashAt(i)->~T();
+        target.keys[slot] = stash_keys[i];
+        target.used |= (uint8_t)(1 << slot);
+        stash_count--;
+        if (i != stash_count) {
+            stash_keys[i] = stash_keys[stash_count];
+            new (stash[i]) T(std::move(*stashAt(stash_count)));
+            stashAt(stash_count)->~T();
+        }
+    }
+}
+
+/*keeps the buckets, like HashTable keeps its size after removes*/
+template<class T>
+void CuckooHashTable<T>::clear()
+{
+    for (int b = 0; b < bucket_count; b++) {
+        for (int i = 0; i < CUCKOO_WAYS; i++) {
+            if (buckets[b].used & (1 << i)) {
+                buckets[b].at(i)->~T();
+            }
+        }
+        buckets[b].used = 0;
+    }
+    for (int i = 0; i < stash_count; i++) {
+        stashAt(i)->~T();
+    }
+    stash_count = 0;
+    count = 0;
+}
+
+#endif // !CUCKOO_HASHTABLE_H
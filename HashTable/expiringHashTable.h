@@ -0,0 +1,414 @@
+#ifndef EXPIRING_HASHTABLE_H
+#define EXPIRING_HASHTABLE_H
+
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "hashTable.h"
+#include "../IntrusiveList.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS) //slots per level, one bit each in a level's occupied mask
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4 //covers 2^24 ticks, later deadlines wait in the last level and are placed again
+#define EXPIRE_STEP 4 //elements a normal operation expires on its way
+#define EXPIRE_BATCH 256 //elements the background thread expires per lock hold
+
+struct ExpiryTag {};
+
+/*index of the lowest set bit, mask must not be 0*/
+static inline int wheelFirstBitAUX(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/*distance from bit from to the next set bit at or after it, wrapping around. mask must not be 0*/
+static inline int wheelNextBitAUX(uint64_t mask, int from) {
+    uint64_t rotated = from == 0 ? mask : (mask >> from) | (mask << (WHEEL_SLOTS - from));
+    return wheelFirstBitAUX(rotated);
+}
+
+/********************************** EXPIRING ENTRY IMPLEMENTATION **********************************/
+template<class T>
+class ExpiringEntry : public ListHook<ExpiryTag> {
+public:
+    T data;
+    uint64_t deadline; //first tick the element is expired at
+    int slot; //level * WHEEL_SLOTS + index of the wheel list it is linked into
+
+    ExpiringEntry() : data(), deadline(0), slot(0) {} //the chains' dummy nodes
+    explicit ExpiringEntry(const T& _data, uint64_t _deadline = 0) : data(_data), deadline(_deadline), slot(0) {}
+
+    int operator()() const { //key used by HashTable when rehashing
+        return data();
+    }
+
+    bool operator==(const ExpiringEntry<T>& other) const {
+        return data == other.data;
+    }
+};
+
+/**********************************EXPIRING HASHTABLE IMPLEMENTATION **********************************/
+/* HashTable whose elements expire after a time to live - every entry is a HashTable element that is also
+* linked into a hierarchical timer wheel (an IntrusiveList per slot), the way LRUCache links its entries
+* into a recency list. time is counted in ticks of tick_length since the table was built:
+* level 0 has one slot per tick for the next WHEEL_SLOTS ticks, every further level covers WHEEL_SLOTS times
+* the span of the one below. when the wheel reaches a level's boundary the next slot of the level above is
+* cascaded - its entries are linked again one level lower (at most WHEEL_LEVELS times per entry), so
+* expiring costs O(1) per element and the table is never scanned. the occupied masks of every level give
+* the next tick that expires or cascades anything, so an idle gap of any length is crossed in one step.
+* expired elements are invisible to get right away, and are freed incrementally - every operation expires up
+* to EXPIRE_STEP of them, and startExpiry runs a thread that does the rest in batches of EXPIRE_BATCH.
+* all operations take the table's lock. same element requirements as HashTable (operator() returns the key,
+* operator== compares, keys must not be negative, default constructible) plus T must be copyable.
+* Clock only needs now(), a fake one makes tests independent of real time*/
+template<class T, class Clock = std::chrono::steady_clock>
+class ExpiringHashTable {
+    typedef ExpiringEntry<T> Entry;
+
+    HashTable<Entry> index;
+    IntrusiveList<Entry, ExpiryTag> wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+    uint64_t occupied[WHEEL_LEVELS]; //bit i set = wheel[level][i] is not empty
+    uint64_t current; //next tick to expire, every deadline before it is gone
+    typename Clock::time_point start;
+    typename Clock::duration tick_length;
+    uint64_t expired;
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::thread expiry_thread;
+    bool stopping;
+
+    uint64_t nowTick() const {
+        return (uint64_t)((Clock::now() - start) / tick_length);
+    }
+    uint64_t ticksOf(std::chrono::milliseconds ttl) const; //rounded up
+    Entry* findEntry(const T& element, int key);
+    void schedule(Entry* entry); //links entry into the wheel by its deadline
+    void unschedule(Entry* entry);
+    void removeEntry(Entry* entry);
+    void cascade(); //current just reached a level 0 boundary
+    uint64_t nextEvent() const; //first tick after current that expires or cascades something, UINT64_MAX if none
+    int expireAUX(uint64_t target, int max); //expires deadlines up to target, at most max elements
+    void expiryLoop(std::chrono::milliseconds period);
+
+public:
+    explicit ExpiringHashTable(std::chrono::milliseconds _tick_length = std::chrono::milliseconds(1),
+        std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+    ~ExpiringHashTable(); //stops the expiry thread
+    ExpiringHashTable(const ExpiringHashTable<T, Clock>& table) = delete; //the wheel links point into the table
+    ExpiringHashTable<T, Clock>& operator=(const ExpiringHashTable<T, Clock>& table) = delete;
+    bool insert(const T& element, int key, std::chrono::milliseconds ttl); //false if a live equal element exists
+    bool get(const T& element, int key, T& out); //copies the element out, false if missing or expired
+    bool touch(const T& element, int key, std::chrono::milliseconds ttl); //restarts the element's time to live
+    bool remove(const T& element, int key);
+    int expire(int max = INT_MAX); //frees up to max expired elements now, returns how many
+    void startExpiry(std::chrono::milliseconds period); //background expiry every period, until stopExpiry
+    void stopExpiry();
+    int getCount(); //includes expired elements that are not freed yet
+    uint64_t getExpired(); //elements freed by expiry so far
+};
+
+template<class T, class Clock>
+ExpiringHashTable<T, Clock>::ExpiringHashTable(std::chrono::milliseconds _tick_length, std::pmr::memory_resource* _resource)
+    : index(_resource), current(0), start(Clock::now()), expired(0), stopping(false)
+{
+    tick_length = std::chrono::duration_cast<typename Clock::duration>(_tick_length);
+    if (tick_length <= Clock::duration::zero()) {
+        tick_length = typename Clock::duration(1);
+    }
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        occupied[level] = 0;
+    }
+}
+
+template<class T, class Clock>
+ExpiringHashTable<T, Clock>::~ExpiringHashTable()
+{
+    stopExpiry();
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int i = 0; i < WHEEL_SLOTS; i++) {
+            wheel[level][i].clear(); //entries are freed by the table
+        }
+    }
+}
+
+template<class T, class Clock>
+uint64_t ExpiringHashTable<T, Clock>::ticksOf(std::chrono::milliseconds ttl) const
+{
+    if (ttl <= std::chrono::milliseconds::zero()) {
+        return 0;
+    }
+    typename Clock::duration length = std::chrono::duration_cast<typename Clock::duration>(ttl);
+    return (uint64_t)((length + tick_length - typename Clock::duration(1)) / tick_length);
+}
+
+template<class T, class Clock>
+ExpiringEntry<T>* ExpiringHashTable<T, Clock>::findEntry(const T& element, int key)
+{
+    Entry probe(element);
+    Node<Entry>* node = index.find(&probe, key);
+    return node == nullptr ? nullptr : &node->data;
+}
+
+/*a deadline that already passed goes to the slot expired next. deadlines past the last level's span are
+  parked in the last level at the farthest slot and placed again when it cascades*/
+template<class T, class Clock>
+void ExpiringHashTable<T, Clock>::schedule(Entry* entry)
+{
+    uint64_t when = entry->deadline > current ? entry->deadline : current;
+    uint64_t span = 1ULL << (WHEEL_BITS * WHEEL_LEVELS);
+    if (when - current >= span) {
+        when = current + span - 1;
+    }
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && when - current >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int i = (int)((when >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    wheel[level][i].push_back(entry);
+    occupied[level] |= 1ULL << i;
+    entry->slot = level * WHEEL_SLOTS + i;
+}
+
+template<class T, class Clock>
+void ExpiringHashTable<T, Clock>::unschedule(Entry* entry)
+{
+    int level = entry->slot / WHEEL_SLOTS;
+    int i = entry->slot % WHEEL_SLOTS;
+    wheel[level][i].remove(entry);
+    if (wheel[level][i].isEmpty()) {
+        occupied[level] &= ~(1ULL << i);
+    }
+}
+
+/*unlinks from the wheel first, the table deletes the node that holds the entry*/
+template<class T, class Clock>
+void ExpiringHashTable<T, Clock>::removeEntry(Entry* entry)
+{
+    unschedule(entry);
+    index.remove(entry, entry->data());
+}
+
+/*the slot of level 1 that starts at current holds deadlines within the next WHEEL_SLOTS ticks, they move
+  down to level 0. when that slot is the first of level 1, level 2 has reached a boundary too, and so on.
+  only the entries that were there before are moved, a parked one may land in the same slot again*/
+template<class T, class Clock>
+void ExpiringHashTable<T, Clock>::cascade()
+{
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        int i = (int)((current >> (WHEEL_BITS * level)) & WHEEL_MASK);
+        IntrusiveList<Entry, ExpiryTag>& slot = wheel[level][i];
+        for (int n = slot.getSize(); n > 0; n--) {
+            schedule(slot.pop_front());
+        }
+        if (slot.isEmpty()) {
+            occupied[level] &= ~(1ULL << i);
+        }
+        if (i != 0) {
+            break;
+        }
+    }
+}
+
+/*level L (above 0) cascades slot (t >> 6L) & 63 at every tick t that is a multiple of its slot width 2^6L,
+  so its first occupied slot from there on (wrapping) gives its next cascade. level 0 expires slot t & 63 at
+  t. the boundaries in between would cascade empty slots and can be skipped*/
+template<class T, class Clock>
+uint64_t ExpiringHashTable<T, Clock>::nextEvent() const
+{
+    uint64_t next = UINT64_MAX;
+    if (occupied[0] != 0) {
+        next = current + wheelNextBitAUX(occupied[0], (int)(current & WHEEL_MASK));
+    }
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if (occupied[level] == 0) {
+            continue;
+        }
+        int shift = WHEEL_BITS * level;
+        uint64_t boundary = ((current >> shift) + 1) << shift;
+        uint64_t when = boundary + ((uint64_t)wheelNextBitAUX(occupied[level], (int)((boundary >> shift) & WHEEL_MASK)) << shift);
+        if (when < next) {
+            next = when;
+        }
+    }
+    return next;
+}
+
+/*stops in the middle of a slot when max is reached, the next call goes on from there*/
+template<class T, class Clock>
+int ExpiringHashTable<T, Clock>::expireAUX(uint64_t target, int max)
+{
+    int freed = 0;
+    while (current <= target) {
+        if (index.getCount() == 0) { //nothing to expire or cascade
+            current = target + 1;
+            break;
+        }
+        int i = (int)(current & WHEEL_MASK);
+        if ((occupied[0] & (1ULL << i)) == 0) { //jumps straight to the next slot that expires or cascades
+            uint64_t next = nextEvent();
+            current = next <= target + 1 ? next : target + 1;
+            if ((current & WHEEL_MASK) == 0) {
+                cascade();
+            }
+            continue;
+        }
+        IntrusiveList<Entry, ExpiryTag>& slot = wheel[0][i];
+        while (!slot.isEmpty()) {
+            if (freed == max) {
+                return freed;
+            }
+            Entry* entry = slot.pop_front();
+            index.remove(entry, entry->data());
+            expired++;
+            freed++;
+        }
+        occupied[0] &= ~(1ULL << i);
+        current++;
+        if ((current & WHEEL_MASK) == 0) {
+            cascade();
+        }
+    }
+    return freed;
+}
+
+/*an equal element that expired but was not freed yet is replaced*/
+template<class T, class Clock>
+bool ExpiringHashTable<T, Clock>::insert(const T& element, int key, std::chrono::milliseconds ttl)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t now = nowTick();
+    expireAUX(now, EXPIRE_STEP);
+    Entry* entry = findEntry(element, key);
+    if (entry != nullptr) {
+        if (entry->deadline > now) {
+            return false;
+        }
+        removeEntry(entry);
+        expired++;
+    }
+    Node<Entry>* node = index.emplace(key, element, now + ticksOf(ttl)); //built inside the table's node
+    schedule(&node->data);
+    return true;
+}
+
+template<class T, class Clock>
+bool ExpiringHashTable<T, Clock>::get(const T& element, int key, T& out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t now = nowTick();
+    expireAUX(now, EXPIRE_STEP);
+    Entry* entry = findEntry(element, key);
+    if (entry == nullptr || entry->deadline <= now) {
+        return false;
+    }
+    out = entry->data;
+    return true;
+}
+
+template<class T, class Clock>
+bool ExpiringHashTable<T, Clock>::touch(const T& element, int key, std::chrono::milliseconds ttl)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t now = nowTick();
+    expireAUX(now, EXPIRE_STEP);
+    Entry* entry = findEntry(element, key);
+    if (entry == nullptr || entry->deadline <= now) {
+        return false;
+    }
+    unschedule(entry);
+    entry->deadline = now + ticksOf(ttl);
+    schedule(entry);
+    return true;
+}
+
+/*false for an element that already expired, like get*/
+template<class T, class Clock>
+bool ExpiringHashTable<T, Clock>::remove(const T& element, int key)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t now = nowTick();
+    expireAUX(now, EXPIRE_STEP);
+    Entry* entry = findEntry(element, key);
+    if (entry == nullptr) {
+        return false;
+    }
+    bool live = entry->deadline > now;
+    removeEntry(entry);
+    if (!live) {
+        expired++;
+    }
+    return live;
+}
+
+template<class T, class Clock>
+int ExpiringHashTable<T, Clock>::expire(int max)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return expireAUX(nowTick(), max);
+}
+
+/*the lock is let go between batches so the other threads are not held up by a large expiry*/
+template<class T, class Clock>
+void ExpiringHashTable<T, Clock>::expiryLoop(std::chrono::milliseconds period)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (!stopping) {
+        if (expireAUX(nowTick(), EXPIRE_BATCH) == EXPIRE_BATCH) {
+            guard.unlock();
+            std::this_thread::yield();
+            guard.lock();
+            continue;
+        }
+        wakeup.wait_for(guard, period, [this] { return stopping; });
+    }
+}
+
+template<class T, class Clock>
+void ExpiringHashTable<T, Clock>::startExpiry(std::chrono::milliseconds period)
+{
+    stopExpiry();
+    stopping = false;
+    expiry_thread = std::thread(&ExpiringHashTable<T, Clock>::expiryLoop, this, period);
+}
+
+template<class T, class Clock>
+void ExpiringHashTable<T, Clock>::stopExpiry()
+{
+    if (!expiry_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    expiry_thread.join();
+}
+
+template<class T, class Clock>
+int ExpiringHashTable<T, Clock>::getCount()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return index.getCount();
+}
+
+template<class T, class Clock>
+uint64_t ExpiringHashTable<T, Clock>::getExpired()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return expired;
+}
+
+#endif // !EXPIRING_HASHTABLE_H
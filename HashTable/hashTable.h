@@ -1,9 +1,22 @@
 #ifndef HASHTABLE_H
 #define HASHTABLE_H
 
+#include <climits>
+#include <cstring>
 #include <iostream>
+#include <thread>
+#include <type_traits>
 #include "list.h"
+#include "../vector.h"
+#include "bloomFilter.h"
+#include "../Snapshot.h"
+#include "../MemoryUsage.h"
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
 #define N 5
+#define HASH_BATCH 16 //keys per group in findMany
+#define HASH_INFLIGHT 8 //lookups in flight in findManyInterleaved
 
 
 /*NOTE:  template class must have operator() which returns the insertion key which will be used in hash function*/
@@ -12,42 +25,119 @@ template<class T>
 class Chain {
 public:
     List<T>* chain;
-    Chain() : chain(new List<T>()) {}
+    std::pmr::memory_resource* resource;
+    explicit Chain(std::pmr::memory_resource* _resource = std::pmr::get_default_resource())
+        : chain(createObject<List<T>>(_resource, _resource)), resource(_resource) {}
     ~Chain() {
-        delete chain;
+        destroyObject(resource, chain);
     }
 
     Node<T>* insertElement(T* element);//created new node and inserts to the chain
-    int removeElement(T* element); //deletes element
+    Node<T>* insertElement(T&& element); //moves element into the new node
+    template<class... Args>
+    Node<T>* emplaceElement(Args&&... args); //constructs the element inside the new node
+    int removeElement(const T& element); //deletes element
     Node<T>* popElement(); //pops without deleting
     void pushElement(Node<T>* node); //pushes already existing node to chain
-    Node<T>* findElement(T* element);
+    Node<T>* findElement(const T& element);
     int getChainSize();
    
 };
 
 
+/*asks for the cache line of p without waiting for it, a lookup that needs it later finds it loaded*/
+static inline void hashPrefetchAUX(const void* p) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    _mm_prefetch((const char*)p, _MM_HINT_T0);
+#else
+    __builtin_prefetch(p);
+#endif
+}
+
+/*filled by HashTable::getFilterStats*/
+struct HashFilterStats {
+    uint64_t lookups; //finds that consulted the filter
+    uint64_t rejected; //misses answered by the filter alone
+    uint64_t false_positives; //passed the filter but werent in the chain
+    double observed_fpr; //false_positives / (rejected + false_positives)
+    double estimated_fpr; //from the filter's fill, includes keys removed since the last rebuild
+};
+
+/*when HashTable resizes (see setLoadPolicy), the load is count / size:
+* max_load: an insert that brings the load up to it grows the table by growth
+* min_load: a remove that brings it down to it shrinks the table by growth
+* after a resize the load is max_load / growth or min_load * growth. setLoadPolicy asks for
+* min_load * growth * growth <= max_load, so both are a factor of growth away from the other threshold and
+* inserts and removes around one threshold cannot make the table resize back and forth.
+* the defaults are the thresholds HashTable always had*/
+struct HashLoadPolicy {
+    double max_load = 1.0;
+    double min_load = 0.25;
+    double growth = 2.0;
+};
+
 /* dynamic HashTable - uses chain hashing (modulo function)
 * dynamic_arr: a dynamic array where each cell holds a chain of elements of type T
 * size: the size of the hash table, aka the current size of the dynamic array
-* count: keeps track of the number of elements in the table for the purpose of rehashing*/
+* count: keeps track of the number of elements in the table for the purpose of rehashing
+* load_policy: the load factors rehash() grows and shrinks at
+* resource: the bucket array, the chains and their nodes are all allocated from it
+* filter: optional bloom filter over the keys (see enableFilter), lets most misses skip the chain walk*/
 template<class T>
 class HashTable {
     Chain<T>** dynamic_arr;
     int size;
     int count;
+    HashLoadPolicy load_policy;
+    std::pmr::memory_resource* resource;
+    BloomFilter* filter;
+    int filter_bits;
+    uint64_t filter_lookups;
+    uint64_t filter_rejected;
+    uint64_t filter_false_positives;
+
+    void resetFilter(); //empty filter sized for the current size
+    Chain<T>* chainOf(int key); //creates the chain if the cell is empty
+    Node<T>* inserted(Node<T>* element_node, int key); //counts a new node and rehashes if needed
+    int grownSize(int from);
+    int shrunkSize(int from);
+    int fittedSize(bool shrink_to_fit); //size the policy settles at for count elements
+    void resize(int new_size); //moves every node to a new bucket array
 
 public:
-    HashTable();
-    HashTable(int _size);
+    explicit HashTable(std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+    HashTable(int _size, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+    HashTable(const HashTable<T>& table) = delete; //chains would be shared
+    HashTable(HashTable<T>&& table); //takes table's buckets and resource, table is left empty
     ~HashTable();
+    HashTable<T>& operator=(const HashTable<T>& table) = delete;
+    HashTable<T>& operator=(HashTable<T>&& table);
     int hash(int key);
     void rehash();
+    int shrinkToFit(); //smallest size that holds count below max_load, also frees the chains removes left empty, returns the size
+    bool setLoadPolicy(const HashLoadPolicy& policy); //false if the thresholds are too close (see HashLoadPolicy), resizes to fit
+    HashLoadPolicy getLoadPolicy();
     Node<T>* insert(T* element, int key);
+    Node<T>* insert(T&& element, int key);
+    template<class... Args>
+    Node<T>* emplace(int key, Args&&... args);
     void remove(T* element, int key);
+    void remove(const T& element, int key);
     Node<T>* find(T* element, int key);
+    Node<T>* find(const T& element, int key);
+    int findMany(const int* keys, int n, Node<T>** out); //out[i] = element whose operator() returns keys[i] or nullptr, returns the number found
+    int findManyInterleaved(const int* keys, int n, Node<T>** out); //same results, better when chains are long
     int getSize();
     int getCount();
+    std::pmr::memory_resource* getResource();
+    MemoryUsage memoryUsage() const; //walks the bucket array, O(size)
+    bool save(const char* path); //binary snapshot, T must be trivially copyable
+    bool load(const char* path); //replaces the table with the snapshot's elements, no rehashing
+    int build(Vector<T>& elements, int n, int threads = 0); //replaces the table with elements[0..n-1], returns count
+    void enableFilter(int bits_per_key = 10);
+    void disableFilter();
+    void rebuildFilter(); //drops the keys of removed elements, rehash() does it whenever it resizes
+    HashFilterStats getFilterStats();
     Chain<T>& operator[](int i) {
         return *dynamic_arr[i];
     }
@@ -61,14 +151,34 @@ Node<T>* Chain<T>::insertElement(T* element) {
     if (chain->find(*element) != nullptr)
         return nullptr;
 
-    chain->insestAfterNode(*element, chain->getHead());
-    return chain->getHead()->next;
+    return chain->emplaceAfter(chain->getHead(), *element);
+}
+
+template<class T>
+Node<T>* Chain<T>::insertElement(T&& element) {
+    if (chain->find(element) != nullptr)
+        return nullptr; //element is left untouched
+
+    return chain->emplaceAfter(chain->getHead(), std::move(element));
+}
+
+/*the element has to exist before it can be compared, so the node is built first and deleted if it is a duplicate*/
+template<class T>
+template<class... Args>
+Node<T>* Chain<T>::emplaceElement(Args&&... args) {
+    Node<T>* node = createObject<Node<T>>(resource, std::in_place, std::forward<Args>(args)...);
+    if (chain->find(node->data) != nullptr) {
+        destroyObject(resource, node);
+        return nullptr;
+    }
+    chain->push_front(node);
+    return node;
 }
 
 /*returns 0 on success, -1 if element not found*/
 template<class T>
-int Chain<T>::removeElement(T* element) {
-    Node<T>* temp = chain->find(*element);
+int Chain<T>::removeElement(const T& element) {
+    Node<T>* temp = chain->find(element);
     if (temp != nullptr) {
         chain->remove(temp);
         return 0;
@@ -88,9 +198,9 @@ void Chain<T>::pushElement(Node<T>* node) {
 }
 
 template<class T>
-Node<T>* Chain<T>::findElement(T* element)
+Node<T>* Chain<T>::findElement(const T& element)
 {
-    return chain->find(*element);
+    return chain->find(element);
 }
 
 template<class T>
@@ -100,32 +210,90 @@ int Chain<T>::getChainSize() {
 
 /******************************************************************/
 template<class T>
-HashTable<T>::HashTable() {
+HashTable<T>::HashTable(std::pmr::memory_resource* _resource)
+    : resource(_resource), filter(nullptr), filter_bits(0), filter_lookups(0), filter_rejected(0), filter_false_positives(0) {
     size = N;
     count = 0;
-    dynamic_arr = new Chain<T>*[N];
+    dynamic_arr = allocateArray<Chain<T>*>(resource, N);
     for (int i = 0; i < size; i++) {
         dynamic_arr[i] = nullptr;
     }
 }
 
 template<class T>
-HashTable<T>::HashTable(int _size) {
+HashTable<T>::HashTable(int _size, std::pmr::memory_resource* _resource)
+    : resource(_resource), filter(nullptr), filter_bits(0), filter_lookups(0), filter_rejected(0), filter_false_positives(0) {
     size = _size;
     count = 0;
-    dynamic_arr = new Chain<T>*[size];
+    dynamic_arr = allocateArray<Chain<T>*>(resource, size);
     for (int i = 0; i < size; i++) {
         dynamic_arr[i] = nullptr;
     }
 }
 
+/*table is left as a new empty table on its own resource*/
+template<class T>
+HashTable<T>::HashTable(HashTable<T>&& table)
+    : dynamic_arr(table.dynamic_arr), size(table.size), count(table.count), load_policy(table.load_policy), resource(table.resource),
+    filter(table.filter), filter_bits(table.filter_bits), filter_lookups(table.filter_lookups),
+    filter_rejected(table.filter_rejected), filter_false_positives(table.filter_false_positives) {
+    table.size = N;
+    table.count = 0;
+    table.dynamic_arr = allocateArray<Chain<T>*>(table.resource, N);
+    for (int i = 0; i < N; i++) {
+        table.dynamic_arr[i] = nullptr;
+    }
+    table.filter = nullptr;
+    table.filter_bits = 0;
+    table.filter_lookups = table.filter_rejected = table.filter_false_positives = 0;
+}
+
+/*swaps everything with table when both use the same resource (table frees this one's old contents),
+  otherwise the elements are moved into new nodes one by one*/
+template<class T>
+HashTable<T>& HashTable<T>::operator=(HashTable<T>&& table) {
+    if (this == &table)
+        return *this;
+    if (resource == table.resource) {
+        std::swap(dynamic_arr, table.dynamic_arr);
+        std::swap(size, table.size);
+        std::swap(count, table.count);
+        std::swap(load_policy, table.load_policy);
+        std::swap(filter, table.filter);
+        std::swap(filter_bits, table.filter_bits);
+        std::swap(filter_lookups, table.filter_lookups);
+        std::swap(filter_rejected, table.filter_rejected);
+        std::swap(filter_false_positives, table.filter_false_positives);
+        return *this;
+    }
+    HashTable<T> moved(std::move(table)); //empties table right away
+    HashTable<T> fresh(resource);
+    std::swap(dynamic_arr, fresh.dynamic_arr);
+    std::swap(size, fresh.size);
+    std::swap(count, fresh.count); //old contents are freed with fresh
+    load_policy = moved.load_policy;
+    for (int i = 0; i < moved.size; i++) {
+        if (moved.dynamic_arr[i] == nullptr)
+            continue;
+        List<T>* chain = moved.dynamic_arr[i]->chain;
+        for (Node<T>* node = chain->begin(); node != chain->getTail(); node = node->next) {
+            int key = node->data();
+            insert(std::move(node->data), key);
+        }
+    }
+    if (filter != nullptr)
+        rebuildFilter(); //drops the keys of the old contents
+    return *this;
+}
+
 template<class T>
 HashTable<T>::~HashTable() {
     for (int i = 0; i < size; i++) {
         if (dynamic_arr[i] != nullptr)
-            delete dynamic_arr[i];
+            destroyObject(resource, dynamic_arr[i]);
     }
-    delete[] dynamic_arr;
+    deallocateArray(resource, dynamic_arr, size);
+    destroyObject(resource, filter);
 }
 
 template<class T>
@@ -137,22 +305,53 @@ int HashTable<T>::hash(int key)
 template<class T>
 void HashTable<T>::rehash() {
     //check if theres a need for rehashing
-    int old_size = size;
-    if (old_size == count) { //must increase size
-        size = (size * 2) + 1;
+    if (count >= load_policy.max_load * size) { //must increase size
+        resize(grownSize(size));
+    }
+    else if (count <= load_policy.min_load * size && shrunkSize(size) >= N) { //must decrease size
+        resize(shrunkSize(size));
     }
-    else if (old_size >= count * 4) { //must decrease size
-        old_size = (size - 1) / 2;
+}
+
+/*odd sizes like the original size * 2 + 1, which the default growth still gives*/
+template<class T>
+int HashTable<T>::grownSize(int from) {
+    int grown = (int)(from * load_policy.growth) | 1;
+    return grown > from ? grown : from + 2;
+}
+
+template<class T>
+int HashTable<T>::shrunkSize(int from) {
+    int shrunk = (int)(from / load_policy.growth) | 1;
+    return shrunk < from ? shrunk : from - 2;
+}
+
+/*steps through the sizes rehash() would go through, without moving anything*/
+template<class T>
+int HashTable<T>::fittedSize(bool shrink_to_fit) {
+    int fitted = size;
+    while (count >= load_policy.max_load * fitted) {
+        fitted = grownSize(fitted);
     }
-    else {
-        return; //no need for rehash
+    while (shrunkSize(fitted) >= N && (shrink_to_fit ? count < load_policy.max_load * shrunkSize(fitted)
+                                                     : count <= load_policy.min_load * fitted)) {
+        fitted = shrunkSize(fitted);
     }
+    return fitted;
+}
+
+template<class T>
+void HashTable<T>::resize(int new_size) {
+    int old_size = size;
+    size = new_size;
 
     //create new hashtable and initialize it
-    Chain<T>** new_arr = new Chain<T>*[size]; //new arr with updated size
+    Chain<T>** new_arr = allocateArray<Chain<T>*>(resource, size); //new arr with updated size
     for (int i = 0; i < size; i++) {
         new_arr[i] = nullptr;
     }
+    if (filter != nullptr) //rebuilt while the nodes move, which also forgets removed keys
+        resetFilter();
 
     //copy nodes from old table to new one
     for (int i = 0; i < old_size; i++) {
@@ -162,10 +361,12 @@ void HashTable<T>::rehash() {
             while (current_chain->getChainSize() > 0) {
                 chain_node = current_chain->popElement();
                 if (new_arr[hash(chain_node->data())] == nullptr) { //if cell in new arr is empty
-                    new_arr[hash(chain_node->data())] = new Chain<T>();
+                    new_arr[hash(chain_node->data())] = createObject<Chain<T>>(resource, resource);
                 }
 
                 new_arr[hash(chain_node->data())]->pushElement(chain_node); //push node to chain
+                if (filter != nullptr)
+                    filter->add(chain_node->data());
             }
         }
     }
@@ -175,23 +376,77 @@ void HashTable<T>::rehash() {
     dynamic_arr = new_arr; //switch ptrs
     for (int i = 0; i < old_size; i++) {
         if (del_arr[i] != nullptr)
-            delete del_arr[i];
+            destroyObject(resource, del_arr[i]);
     }
-    delete del_arr;
+    deallocateArray(resource, del_arr, old_size);
+}
+
+/*also worth calling at the same size after many removes: every cell keeps its chain (a List and its dummy
+  nodes) until the nodes move*/
+template<class T>
+int HashTable<T>::shrinkToFit() {
+    resize(fittedSize(true));
+    return size;
+}
+
+template<class T>
+bool HashTable<T>::setLoadPolicy(const HashLoadPolicy& policy) {
+    if (!(policy.max_load > 0) || !(policy.min_load >= 0) || !(policy.growth > 1) ||
+        policy.min_load * policy.growth * policy.growth > policy.max_load)
+        return false;
+    load_policy = policy;
+    int fitted = fittedSize(false);
+    if (fitted != size)
+        resize(fitted);
+    return true;
+}
+
+template<class T>
+HashLoadPolicy HashTable<T>::getLoadPolicy() {
+    return load_policy;
 }
 
 /*key will be used in hash function to determine which index of insertion in the arr
  * returns null if insertion failed, else returns pointer to the element node*/
 template<class T>
 Node<T>* HashTable<T>::insert(T* element, int key)
+{
+    return inserted(chainOf(key)->insertElement(element), key);
+}
+
+template<class T>
+Node<T>* HashTable<T>::insert(T&& element, int key)
+{
+    return inserted(chainOf(key)->insertElement(std::move(element)), key);
+}
+
+/*the key must be the one the constructed element returns from operator()*/
+template<class T>
+template<class... Args>
+Node<T>* HashTable<T>::emplace(int key, Args&&... args)
+{
+    return inserted(chainOf(key)->emplaceElement(std::forward<Args>(args)...), key);
+}
+
+template<class T>
+Chain<T>* HashTable<T>::chainOf(int key)
 {
     int index = hash(key);
     if (dynamic_arr[index] == nullptr) { //cell is empty
-        dynamic_arr[index] = new Chain<T>();
+        dynamic_arr[index] = createObject<Chain<T>>(resource, resource);
     }
-    //add element
-    Node<T>* element_node = (dynamic_arr[index])->insertElement(element);
+    return dynamic_arr[index];
+}
+
+/*element_node is null if the element already existed*/
+template<class T>
+Node<T>* HashTable<T>::inserted(Node<T>* element_node, int key)
+{
+    if (element_node == nullptr) //element already exists
+        return nullptr;
     count++;
+    if (filter != nullptr)
+        filter->add(key);
     rehash(); //checks if theres a need to rehash, and does rehash accordingly
     return element_node;
 }
@@ -199,6 +454,11 @@ Node<T>* HashTable<T>::insert(T* element, int key)
 /*key will be used in hash function to determine which index of insertion in the arr */
 template<class T>
 void HashTable<T>::remove(T* element, int key) {
+    remove(*element, key);
+}
+
+template<class T>
+void HashTable<T>::remove(const T& element, int key) {
     int index = hash(key);
     if (dynamic_arr[index] == nullptr)
         return;
@@ -214,11 +474,194 @@ void HashTable<T>::remove(T* element, int key) {
 /*returns nullptr if not found*/
 template<class T>
 Node<T>* HashTable<T>::find(T* element, int key) {
+    return find(*element, key);
+}
+
+template<class T>
+Node<T>* HashTable<T>::find(const T& element, int key) {
+    if (filter != nullptr) {
+        filter_lookups++;
+        if (!filter->mayContain(key)) {
+            filter_rejected++;
+            return nullptr;
+        }
+    }
     int index = hash(key);
-    if (dynamic_arr[index] == nullptr)
-        return nullptr;
+    Node<T>* found = dynamic_arr[index] == nullptr ? nullptr : dynamic_arr[index]->findElement(element);
+    if (found == nullptr && filter != nullptr)
+        filter_false_positives++;
+    return found;
+}
 
-    return dynamic_arr[index]->findElement(element);
+/*batched lookups with group prefetching - every key of a group goes through one step of the lookup
+  (bucket slot, chain, list, first node) before any of them takes the next, and each step prefetches what
+  the next one loads. so a group waits on memory about once per step instead of once per key per step.
+  the hashes are a modulo by the odd table size, which has no SIMD form, they are computed in their own
+  loop so the divisions overlap. the chains themselves are walked without prefetching*/
+template<class T>
+int HashTable<T>::findMany(const int* keys, int n, Node<T>** out)
+{
+    int index[HASH_BATCH]; //-1 = rejected by the filter
+    Chain<T>* chains[HASH_BATCH];
+    List<T>* lists[HASH_BATCH];
+    Node<T>* nodes[HASH_BATCH];
+    Node<T>* tails[HASH_BATCH];
+    int found = 0;
+    for (int first = 0; first < n; first += HASH_BATCH) {
+        int batch = n - first < HASH_BATCH ? n - first : HASH_BATCH;
+        const int* batch_keys = keys + first;
+        for (int i = 0; i < batch; i++) {
+            index[i] = hash(batch_keys[i]);
+        }
+        if (filter != nullptr) {
+            filter_lookups += batch;
+            for (int i = 0; i < batch; i++) {
+                if (!filter->mayContain(batch_keys[i])) {
+                    index[i] = -1;
+                    filter_rejected++;
+                }
+            }
+        }
+        for (int i = 0; i < batch; i++) {
+            if (index[i] >= 0)
+                hashPrefetchAUX(&dynamic_arr[index[i]]);
+        }
+        for (int i = 0; i < batch; i++) {
+            chains[i] = index[i] < 0 ? nullptr : dynamic_arr[index[i]];
+            if (chains[i] != nullptr)
+                hashPrefetchAUX(chains[i]);
+        }
+        for (int i = 0; i < batch; i++) {
+            lists[i] = chains[i] == nullptr ? nullptr : chains[i]->chain;
+            if (lists[i] != nullptr)
+                hashPrefetchAUX(lists[i]);
+        }
+        for (int i = 0; i < batch; i++) {
+            if (lists[i] == nullptr)
+                continue;
+            nodes[i] = lists[i]->getHead();
+            tails[i] = lists[i]->getTail();
+            hashPrefetchAUX(nodes[i]);
+        }
+        for (int i = 0; i < batch; i++) {
+            if (lists[i] == nullptr)
+                continue;
+            nodes[i] = nodes[i]->next;
+            hashPrefetchAUX(nodes[i]);
+        }
+        for (int i = 0; i < batch; i++) {
+            Node<T>* node = nullptr;
+            if (lists[i] != nullptr) {
+                node = nodes[i];
+                while (node != tails[i] && node->data() != batch_keys[i]) {
+                    node = node->next;
+                }
+                if (node == tails[i])
+                    node = nullptr;
+            }
+            out[first + i] = node;
+            if (node != nullptr)
+                found++;
+            else if (filter != nullptr && index[i] >= 0)
+                filter_false_positives++;
+        }
+    }
+    return found;
+}
+
+/*asynchronous memory access chaining (AMAC) - HASH_INFLIGHT lookups advance round robin, each one by a
+  single load per turn (prefetched on its previous turn), and a finished lookup takes the next key right
+  away. unlike findMany a long chain only holds up its own slot, and its nodes are prefetched too*/
+template<class T>
+int HashTable<T>::findManyInterleaved(const int* keys, int n, Node<T>** out)
+{
+    enum ProbeStage { IDLE, SLOT, CHAIN, LIST, HEAD, WALK };
+    struct Probe {
+        int stage;
+        int i; //index of the key
+        int index; //bucket
+        Chain<T>* chain;
+        List<T>* list;
+        Node<T>* node;
+        Node<T>* tail;
+    };
+    Probe probes[HASH_INFLIGHT];
+    for (int p = 0; p < HASH_INFLIGHT; p++) {
+        probes[p].stage = IDLE;
+    }
+    int next = 0;
+    int active = 0;
+    int found = 0;
+    auto finish = [&](Probe& probe, Node<T>* result) {
+        out[probe.i] = result;
+        if (result != nullptr)
+            found++;
+        else if (filter != nullptr)
+            filter_false_positives++;
+        probe.stage = IDLE;
+        active--;
+    };
+    for (int p = 0; next < n || active > 0; p = (p + 1) % HASH_INFLIGHT) {
+        Probe& probe = probes[p];
+        switch (probe.stage) {
+        case IDLE:
+            while (next < n) { //rejected keys finish here, the slot goes on to the next one
+                probe.i = next++;
+                if (filter != nullptr) {
+                    filter_lookups++;
+                    if (!filter->mayContain(keys[probe.i])) {
+                        filter_rejected++;
+                        out[probe.i] = nullptr;
+                        continue;
+                    }
+                }
+                probe.index = hash(keys[probe.i]);
+                hashPrefetchAUX(&dynamic_arr[probe.index]);
+                probe.stage = SLOT;
+                active++;
+                break;
+            }
+            break;
+        case SLOT:
+            probe.chain = dynamic_arr[probe.index];
+            if (probe.chain == nullptr) {
+                finish(probe, nullptr);
+                break;
+            }
+            hashPrefetchAUX(probe.chain);
+            probe.stage = CHAIN;
+            break;
+        case CHAIN:
+            probe.list = probe.chain->chain;
+            hashPrefetchAUX(probe.list);
+            probe.stage = LIST;
+            break;
+        case LIST:
+            probe.node = probe.list->getHead();
+            probe.tail = probe.list->getTail();
+            hashPrefetchAUX(probe.node);
+            probe.stage = HEAD;
+            break;
+        case HEAD:
+            probe.node = probe.node->next;
+            hashPrefetchAUX(probe.node);
+            probe.stage = WALK;
+            break;
+        default: //WALK, one node per turn
+            if (probe.node == probe.tail) {
+                finish(probe, nullptr);
+            }
+            else if (probe.node->data() == keys[probe.i]) {
+                finish(probe, probe.node);
+            }
+            else {
+                probe.node = probe.node->next;
+                hashPrefetchAUX(probe.node);
+            }
+            break;
+        }
+    }
+    return found;
 }
 
 template<class T>
@@ -233,5 +676,339 @@ int HashTable<T>::getCount()
     return count;
 }
 
+template<class T>
+std::pmr::memory_resource* HashTable<T>::getResource()
+{
+    return resource;
+}
+
+/*an empty cell is slack, a cell with a chain is overhead together with the chain, its List object and the
+  list's dummy nodes - even when removes emptied the chain, it stays until the next resize or shrinkToFit*/
+template<class T>
+MemoryUsage HashTable<T>::memoryUsage() const
+{
+    MemoryUsage usage = {};
+    usage.overhead = sizeof(HashTable<T>);
+    usage.allocations = 1; //the bucket array
+    for (int i = 0; i < size; i++) {
+        if (dynamic_arr[i] == nullptr) {
+            usage.slack += sizeof(Chain<T>*);
+            continue;
+        }
+        usage.overhead += sizeof(Chain<T>*) + sizeof(Chain<T>);
+        usage += dynamic_arr[i]->chain->memoryUsage();
+        usage.allocations += 2; //the Chain and its List
+    }
+    if (filter != nullptr) {
+        usage.overhead += sizeof(BloomFilter) + (size_t)filter->getBlockCount() * sizeof(BloomBlock);
+        usage.allocations += 2;
+    }
+    return usage;
+}
+
+/*snapshot layout after the header: uint64_t offsets[size + 1] and then all the elements grouped by
+  bucket - the elements of bucket i are elements[offsets[i]] .. elements[offsets[i+1] - 1]*/
+template<class T>
+bool HashTable<T>::save(const char* path)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "snapshot needs trivially copyable elements");
+    static_assert(alignof(T) <= alignof(uint64_t), "element alignment not supported");
+    uint64_t* offsets = new uint64_t[size + 1];
+    T* elements = new T[count > 0 ? count : 1];
+    memset((void*)elements, 0, sizeof(T) * (count > 0 ? count : 1)); //an assignment that skips the padding leaves no heap bytes in it
+    uint64_t written = 0;
+    for (int i = 0; i < size; i++) {
+        offsets[i] = written;
+        if (dynamic_arr[i] == nullptr)
+            continue;
+        List<T>* chain = dynamic_arr[i]->chain;
+        for (Node<T>* node = chain->begin(); node != chain->getTail(); node = node->next) {
+            elements[written++] = node->data;
+        }
+    }
+    offsets[size] = written;
+    SnapshotHeader header = makeSnapshotHeader(SnapshotType::HASH_TABLE, sizeof(T), 0, written, size);
+    bool ok = writeSnapshot(path, header, offsets, sizeof(uint64_t) * (size + 1), elements, sizeof(T) * written);
+    delete[] elements;
+    delete[] offsets;
+    return ok;
+}
+
+/*returns false (and leaves the table untouched) if the file is missing or isnt a matching snapshot*/
+template<class T>
+bool HashTable<T>::load(const char* path)
+{
+    MappedFile file;
+    if (!file.open(path)) return false;
+    const SnapshotHeader* header = file.checkHeader(SnapshotType::HASH_TABLE, sizeof(T), 0);
+    size_t remaining = file.getLength() - sizeof(SnapshotHeader);
+    if (header == nullptr || header->buckets == 0 || header->buckets > INT_MAX || header->count > INT_MAX ||
+        !takeSnapshotRecords(remaining, header->buckets + 1, sizeof(uint64_t)) ||
+        !takeSnapshotRecords(remaining, header->count, sizeof(T)) ||
+        !checkSnapshotOffsets((const uint64_t*)(file.getData() + sizeof(SnapshotHeader)), header->buckets, header->count)) {
+        return false;
+    }
+    const uint64_t* offsets = (const uint64_t*)(file.getData() + sizeof(SnapshotHeader));
+    const T* elements = (const T*)(offsets + header->buckets + 1);
+
+    for (int i = 0; i < size; i++) {
+        if (dynamic_arr[i] != nullptr)
+            destroyObject(resource, dynamic_arr[i]);
+    }
+    deallocateArray(resource, dynamic_arr, size);
+    size = (int)header->buckets;
+    count = (int)header->count;
+    dynamic_arr = allocateArray<Chain<T>*>(resource, size);
+    for (int i = 0; i < size; i++) {
+        dynamic_arr[i] = nullptr;
+        if (offsets[i] == offsets[i + 1])
+            continue;
+        dynamic_arr[i] = createObject<Chain<T>>(resource, resource);
+        for (uint64_t j = offsets[i]; j < offsets[i + 1]; j++) { //the snapshot was already hashed with this size
+            dynamic_arr[i]->chain->insertBeforeNode(elements[j], dynamic_arr[i]->chain->getTail());
+        }
+    }
+    if (filter != nullptr)
+        rebuildFilter();
+    return true;
+}
+
+/*parallel bulk build, sized once so there is no rehashing on the way:
+  1. every thread hashes a slice of the input and counts how many of its elements fall in each
+     thread's bucket range
+  2. the counts are prefix summed and the threads scatter their element indices by bucket range
+  3. every thread counting-sorts its range by bucket and builds those chains, so no two threads
+     touch the same bucket and no locks are needed. a bucket's nodes are created one after the other
+     by one thread, which keeps them close together in memory
+  duplicates are dropped like in insert. with threads > 1 the resource must be thread safe (like the
+  default one or a synchronized_pool_resource), threads = 0 uses all hardware threads*/
+template<class T>
+int HashTable<T>::build(Vector<T>& elements, int n, int threads)
+{
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+    if (threads > n / 4096 + 1) //small inputs arent worth a thread each
+        threads = n / 4096 + 1;
+
+    for (int i = 0; i < size; i++) {
+        if (dynamic_arr[i] != nullptr)
+            destroyObject(resource, dynamic_arr[i]);
+    }
+    deallocateArray(resource, dynamic_arr, size);
+    size = N;
+    while (n >= load_policy.max_load * size) { //same sizes rehash() goes through, so later inserts/removes behave the same
+        size = grownSize(size);
+    }
+    dynamic_arr = allocateArray<Chain<T>*>(resource, size);
+    for (int i = 0; i < size; i++) {
+        dynamic_arr[i] = nullptr;
+    }
+
+    int* bucket_of = new int[n > 0 ? n : 1];
+    int* by_range = new int[n > 0 ? n : 1]; //element indices grouped by bucket range
+    int* range_counts = new int[threads * threads]; //[slice][range]
+    int* added = new int[threads];
+    auto rangeOf = [this, threads](int bucket) { return (int)((long long)bucket * threads / size); };
+    auto run = [threads](auto phase) {
+        std::thread* workers = new std::thread[threads - 1];
+        for (int t = 1; t < threads; t++) {
+            workers[t - 1] = std::thread(phase, t);
+        }
+        phase(0);
+        for (int t = 1; t < threads; t++) {
+            workers[t - 1].join();
+        }
+        delete[] workers;
+    };
+
+    run([&](int t) {
+        int* counts = range_counts + t * threads;
+        for (int r = 0; r < threads; r++) {
+            counts[r] = 0;
+        }
+        for (int i = (int)((long long)n * t / threads); i < (int)((long long)n * (t + 1) / threads); i++) {
+            bucket_of[i] = hash(elements[i]());
+            counts[rangeOf(bucket_of[i])]++;
+        }
+    });
+    int offset = 0;
+    for (int r = 0; r < threads; r++) { //turn counts into start offsets, range major so each range is contiguous
+        for (int t = 0; t < threads; t++) {
+            int c = range_counts[t * threads + r];
+            range_counts[t * threads + r] = offset;
+            offset += c;
+        }
+    }
+    int* range_start = new int[threads + 1];
+    for (int r = 0; r < threads; r++) {
+        range_start[r] = range_counts[r]; //slice 0 starts every range
+    }
+    range_start[threads] = n;
+    run([&](int t) {
+        int* next = range_counts + t * threads;
+        for (int i = (int)((long long)n * t / threads); i < (int)((long long)n * (t + 1) / threads); i++) {
+            by_range[next[rangeOf(bucket_of[i])]++] = i;
+        }
+    });
+
+    run([&](int r) {
+        int first_bucket = (int)(((long long)size * r + threads - 1) / threads); //first bucket with rangeOf == r
+        int last_bucket = (int)(((long long)size * (r + 1) + threads - 1) / threads);
+        int buckets = last_bucket - first_bucket;
+        int* bucket_start = new int[buckets + 1];
+        int* sorted = new int[range_start[r + 1] - range_start[r] + 1];
+        for (int b = 0; b <= buckets; b++) {
+            bucket_start[b] = 0;
+        }
+        for (int i = range_start[r]; i < range_start[r + 1]; i++) {
+            bucket_start[bucket_of[by_range[i]] - first_bucket + 1]++;
+        }
+        for (int b = 0; b < buckets; b++) {
+            bucket_start[b + 1] += bucket_start[b];
+        }
+        for (int i = range_start[r]; i < range_start[r + 1]; i++) {
+            sorted[bucket_start[bucket_of[by_range[i]] - first_bucket]++] = by_range[i];
+        }
+        added[r] = 0;
+        int current = 0;
+        for (int b = 0; b < buckets; b++) { //bucket_start[b] is now the end of bucket b
+            if (current == bucket_start[b])
+                continue;
+            Chain<T>* chain = createObject<Chain<T>>(resource, resource);
+            for (; current < bucket_start[b]; current++) {
+                if (chain->insertElement(&elements[sorted[current]]) != nullptr)
+                    added[r]++;
+            }
+            dynamic_arr[first_bucket + b] = chain;
+        }
+        delete[] sorted;
+        delete[] bucket_start;
+    });
+
+    count = 0;
+    for (int r = 0; r < threads; r++) {
+        count += added[r];
+    }
+    delete[] range_start;
+    delete[] added;
+    delete[] range_counts;
+    delete[] by_range;
+    delete[] bucket_of;
+    if (filter != nullptr)
+        rebuildFilter();
+    return count;
+}
+
+template<class T>
+void HashTable<T>::resetFilter()
+{
+    destroyObject(resource, filter);
+    filter = createObject<BloomFilter>(resource, size, filter_bits, resource); //sized for the next grow point
+}
+
+/*bits_per_key = 10 gives about 1% false positives once the table is about to grow*/
+template<class T>
+void HashTable<T>::enableFilter(int bits_per_key)
+{
+    filter_bits = bits_per_key;
+    rebuildFilter();
+}
+
+template<class T>
+void HashTable<T>::disableFilter()
+{
+    destroyObject(resource, filter);
+    filter = nullptr;
+}
+
+template<class T>
+void HashTable<T>::rebuildFilter()
+{
+    if (filter_bits == 0)
+        return; //filter was never enabled
+    resetFilter();
+    for (int i = 0; i < size; i++) {
+        if (dynamic_arr[i] == nullptr)
+            continue;
+        List<T>* chain = dynamic_arr[i]->chain;
+        for (Node<T>* node = chain->begin(); node != chain->getTail(); node = node->next) {
+            filter->add(node->data());
+        }
+    }
+}
+
+/*all zeros if the filter isnt enabled*/
+template<class T>
+HashFilterStats HashTable<T>::getFilterStats()
+{
+    HashFilterStats stats = { filter_lookups, filter_rejected, filter_false_positives, 0, 0 };
+    if (filter_rejected + filter_false_positives > 0)
+        stats.observed_fpr = (double)filter_false_positives / (double)(filter_rejected + filter_false_positives);
+    if (filter != nullptr)
+        stats.estimated_fpr = filter->estimateFalsePositiveRate();
+    return stats;
+}
+
+/*read only hash table that works directly on a mapped snapshot file - loading is just mmap + header check
+  and the pages are shared between all processes that load the same file*/
+template<class T>
+class HashTableView {
+    MappedFile file;
+    const uint64_t* offsets;
+    const T* elements;
+    int size;
+    int count;
+
+public:
+    HashTableView() : offsets(nullptr), elements(nullptr), size(0), count(0) {}
+    HashTableView(const HashTableView<T>& view) = delete;
+    HashTableView<T>& operator=(const HashTableView<T>& view) = delete;
+    bool load(const char* path);
+    const T* find(const T* element, int key) const; //nullptr if not found
+    int getSize() const {
+        return size;
+    }
+    int getCount() const {
+        return count;
+    }
+};
+
+template<class T>
+bool HashTableView<T>::load(const char* path)
+{
+    size = 0;
+    count = 0;
+    if (!file.open(path)) return false;
+    const SnapshotHeader* header = file.checkHeader(SnapshotType::HASH_TABLE, sizeof(T), 0);
+    size_t remaining = file.getLength() - sizeof(SnapshotHeader);
+    if (header == nullptr || header->buckets == 0 || header->buckets > INT_MAX || header->count > INT_MAX ||
+        !takeSnapshotRecords(remaining, header->buckets + 1, sizeof(uint64_t)) ||
+        !takeSnapshotRecords(remaining, header->count, sizeof(T)) ||
+        !checkSnapshotOffsets((const uint64_t*)(file.getData() + sizeof(SnapshotHeader)), header->buckets, header->count)) {
+        file.close();
+        return false;
+    }
+    offsets = (const uint64_t*)(file.getData() + sizeof(SnapshotHeader));
+    elements = (const T*)(offsets + header->buckets + 1);
+    size = (int)header->buckets;
+    count = (int)header->count;
+    return true;
+}
+
+/*same hash function as HashTable::hash, so the key must be the one the element was inserted with*/
+template<class T>
+const T* HashTableView<T>::find(const T* element, int key) const
+{
+    if (size == 0)
+        return nullptr;
+    int index = key % size;
+    for (uint64_t i = offsets[index]; i < offsets[index + 1]; i++) { //checked by load
+        if (elements[i] == *element)
+            return &elements[i];
+    }
+    return nullptr;
+}
 
 #endif // !HASHTABLE_H
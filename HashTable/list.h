@@ -2,6 +2,9 @@
 #define LIST_H
 
 #include <iostream>
+#include <utility>
+#include "../MemoryResource.h"
+#include "../MemoryUsage.h"
 
 /********************************** DOUBLE SIDED LIST NODE IMPLEMENTATION **********************************/
 /********************************** MODIFIED FOR USE IN HASH TABLE ****************************************/
@@ -13,28 +16,36 @@ public:
 	D data;
 
 	Node() = default;
-	explicit Node(D _data) : prev(nullptr), next(nullptr), data(_data) {
-		this->data = data;
-	}
+	explicit Node(const D& _data) : prev(nullptr), next(nullptr), data(_data) {}
+	explicit Node(D&& _data) : prev(nullptr), next(nullptr), data(std::move(_data)) {}
+	template<class... Args>
+	explicit Node(std::in_place_t, Args&&... args) : prev(nullptr), next(nullptr), data(std::forward<Args>(args)...) {} //builds data in place
 
 	~Node() {
 		prev = nullptr;
 		next = nullptr;
 	}
 
-	Node(const Node<D>& node) { //copy constructor
+	Node(const Node<D>& node) : prev(node.prev), next(node.next), data(node.data) {} //copy constructor
+	Node(Node<D>&& node) : prev(node.prev), next(node.next), data(std::move(node.data)) {}
+
+	Node<D>& operator=(const Node<D>& node) {
+		if (this == &node) {
+			return *this;
+		}
 		prev = node.prev;
 		next = node.next;
-		data = node.data; //using constructor of class D
+		data = node.data;
+		return *this;
 	}
 
-	Node<D>& operator=(const Node<D>& node) {
+	Node<D>& operator=(Node<D>&& node) {
 		if (this == &node) {
 			return *this;
 		}
 		prev = node.prev;
 		next = node.next;
-		data = data(node.data);
+		data = std::move(node.data);
 		return *this;
 	}
 };
@@ -46,33 +57,50 @@ class List {
 	Node<D>* head; //dummy nodes
 	Node<D>* tail;
 	int size;
+	std::pmr::memory_resource* resource; //all nodes (dummies included) are allocated from here
 
 public:
-	List();
-	List(const List<D>& list); //copy constructor
+	explicit List(std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	List(const List<D>& list); //copy constructor, uses the default resource like the std::pmr containers
+	List(List<D>&& list); //takes list's nodes and resource, list is left empty
 	~List();
-	void insertBeforeNode(D data, Node<D>* node);
-	void insestAfterNode(D data, Node<D>* node);
+	List<D>& operator=(const List<D>& list);
+	List<D>& operator=(List<D>&& list); //relinks the nodes if both lists use the same resource
+	void insertBeforeNode(const D& data, Node<D>* node);
+	void insertBeforeNode(D&& data, Node<D>* node);
+	void insestAfterNode(const D& data, Node<D>* node);
+	void insestAfterNode(D&& data, Node<D>* node);
+	template<class... Args>
+	Node<D>* emplaceBefore(Node<D>* node, Args&&... args); //constructs the data inside the new node
+	template<class... Args>
+	Node<D>* emplaceAfter(Node<D>* node, Args&&... args);
 	Node<D>* remove(Node<D>* node); //deletes node 
 	Node<D>* pop_front(); //pops node without deleting
 	void push_front(Node<D>* node); //pushes already existing node to the beginning of the list (doesnt create new node)
-	Node<D>* find(D data);
+	Node<D>* find(const D& data);
 	Node<D>* begin();
 	Node<D>* end();
 	Node<D>* getHead();
 	Node<D>* getTail();
 	int getSize();
+	MemoryUsage memoryUsage() const; //nodes, both dummy nodes and the list object
 	void destroyNode(Node<D>* to_delete);
+	std::pmr::memory_resource* getResource();
+	void splice(Node<D>* pos, List<D>& other); //moves all of other's nodes before pos
+	void splice(Node<D>* pos, List<D>& other, Node<D>* first, Node<D>* last, int count = -1);
+	void merge(List<D>& other); //both lists must be sorted, other is left empty
+	void sort(); //stable merge sort, relinks nodes without copying data
+	void clear(); //deletes all nodes
 
 };
 
 /*LIST METHODS IMPLEMENTATIONS */
 template<class D>
-List<D>::List()
+List<D>::List(std::pmr::memory_resource* _resource) : resource(_resource)
 {
 	
-	Node<D>* tmp1 = new Node<D>( D() );
-	Node<D>* tmp2 = new Node<D>( D() );
+	Node<D>* tmp1 = createObject<Node<D>>(resource, D());
+	Node<D>* tmp2 = createObject<Node<D>>(resource, D());
 	head = tmp1;
 	tail = tmp2;
 	head->prev = nullptr;
@@ -83,22 +111,18 @@ List<D>::List()
 }
 
 template<class D>
-List<D>::List(const List<D>& list)
+List<D>::List(const List<D>& list) : resource(std::pmr::get_default_resource())
 {
-	head = Node<D>(list.head);
-	tail = Node<D>(list.tail);
-	Node<D>* temp = (list.head)->next;
-	Node<D>* current = head;
-	while (temp != list.tail) {
-		Node<D>* temp1 = Node<D>(temp);
-		current->next = temp1;
-		temp1->prev = current;
-		temp = temp->next; //iteration
-		current = current->next; //iteration
+	head = createObject<Node<D>>(resource, D());
+	tail = createObject<Node<D>>(resource, D());
+	head->prev = nullptr;
+	head->next = tail;
+	tail->prev = head;
+	tail->next = nullptr;
+	size = 0;
+	for (Node<D>* temp = (list.head)->next; temp != list.tail; temp = temp->next) {
+		insertBeforeNode(temp->data, tail);
 	}
-	current->next = tail;
-	tail->prev = current;
-	size = list.size;
 }
 
 template <class D>
@@ -106,35 +130,102 @@ List<D>::~List() {
 	Node<D>* temp = head->next;
 	Node<D>* temp_next = temp->next;
 	while (temp->next != nullptr) {
-		delete temp;
+		destroyObject(resource, temp);
 		temp = temp_next; //iteration
 		temp_next = temp->next; //iteration
 	}
-	delete tail;
-	delete head;
+	destroyObject(resource, tail);
+	destroyObject(resource, head);
 	size = 0;
 }
 
+/*the new list gets its own dummy nodes, so list stays a valid empty list*/
+template<class D>
+List<D>::List(List<D>&& list) : List(list.resource)
+{
+	splice(tail, list);
+}
+
+template<class D>
+List<D>& List<D>::operator=(const List<D>& list)
+{
+	if (this == &list) {
+		return *this;
+	}
+	clear();
+	for (Node<D>* temp = (list.head)->next; temp != list.tail; temp = temp->next) {
+		insertBeforeNode(temp->data, tail);
+	}
+	return *this;
+}
+
+/*nodes can only be relinked between lists of the same resource, otherwise the data is moved into new nodes*/
+template<class D>
+List<D>& List<D>::operator=(List<D>&& list)
+{
+	if (this == &list) {
+		return *this;
+	}
+	clear();
+	if (resource == list.resource) {
+		splice(tail, list);
+		return *this;
+	}
+	for (Node<D>* temp = (list.head)->next; temp != list.tail; temp = temp->next) {
+		insertBeforeNode(std::move(temp->data), tail);
+	}
+	list.clear();
+	return *this;
+}
+
 template<class D>
-void List<D>::insertBeforeNode(D data, Node<D>* insert_before)
+template<class... Args>
+Node<D>* List<D>::emplaceBefore(Node<D>* insert_before, Args&&... args)
 {
-	Node<D>* new_node = new Node<D>(data);
+	Node<D>* new_node = createObject<Node<D>>(resource, std::in_place, std::forward<Args>(args)...);
 	(insert_before->prev)->next = new_node;
 	new_node->prev = insert_before->prev;
 	new_node->next = insert_before;
 	insert_before->prev = new_node;
 	size++;
+	return new_node;
+}
+
+template<class D>
+void List<D>::insertBeforeNode(const D& data, Node<D>* insert_before)
+{
+	emplaceBefore(insert_before, data);
+}
+
+template<class D>
+void List<D>::insertBeforeNode(D&& data, Node<D>* insert_before)
+{
+	emplaceBefore(insert_before, std::move(data));
 }
 
 template<class D>
-void List<D>::insestAfterNode(D data, Node<D>* insert_after)
+template<class... Args>
+Node<D>* List<D>::emplaceAfter(Node<D>* insert_after, Args&&... args)
 {
-	Node<D>* new_node = new Node<D>(data);
+	Node<D>* new_node = createObject<Node<D>>(resource, std::in_place, std::forward<Args>(args)...);
 	(insert_after->next)->prev = new_node;
 	new_node->next = (insert_after->next);
 	insert_after->next = new_node;
 	new_node->prev = insert_after;
 	size++;
+	return new_node;
+}
+
+template<class D>
+void List<D>::insestAfterNode(const D& data, Node<D>* insert_after)
+{
+	emplaceAfter(insert_after, data);
+}
+
+template<class D>
+void List<D>::insestAfterNode(D&& data, Node<D>* insert_after)
+{
+	emplaceAfter(insert_after, std::move(data));
 }
 
 /*returns a pointer to node_to_delete->prev*/
@@ -145,7 +236,7 @@ Node<D>* List<D>::remove(Node<D>* node)
 	(node->prev)->next = node->next;
 	(node->next)->prev = node->prev;
 	size--;
-	delete node;
+	destroyObject(resource, node);
 	return tmp;
 }
 
@@ -172,10 +263,10 @@ void List<D>::push_front(Node<D>* node) {
 
 /*returns pointer to node if found else returns nullptr*/
 template<class D>
-inline Node<D>* List<D>::find(D data)
+inline Node<D>* List<D>::find(const D& data)
 {
-	Node<D>* node = head;
-	while (node->next != nullptr) {
+	Node<D>* node = head->next; //dummy nodes hold no data
+	while (node != tail) {
 		if (node->data == data) return node;
 		node = node->next;
 	}
@@ -215,7 +306,177 @@ inline int List<D>::getSize()
 template<class D>
 void List<D>::destroyNode(Node<D>* to_delete)
 {
-	delete to_delete;
+	destroyObject(resource, to_delete);
+}
+
+template<class D>
+std::pmr::memory_resource* List<D>::getResource()
+{
+	return resource;
+}
+
+/*a node's links and padding are overhead, the dummy nodes are overhead as a whole*/
+template<class D>
+MemoryUsage List<D>::memoryUsage() const
+{
+	MemoryUsage usage = {};
+	usage.payload = (size_t)size * sizeof(D);
+	usage.overhead = sizeof(List<D>) + (size_t)(size + 2) * sizeof(Node<D>) - usage.payload;
+	usage.allocations = size + 2;
+	return usage;
+}
+
+/*moves all nodes of other before pos in O(1), other is left empty*/
+template<class D>
+void List<D>::splice(Node<D>* pos, List<D>& other)
+{
+	if (&other == this || other.size == 0) return;
+	splice(pos, other, other.head->next, other.tail->prev, other.size);
+}
+
+/*moves the nodes [first, last] (last included, same as end()) of other before pos.
+  count is the number of nodes in the range, if it is given the splice is O(1)
+  otherwise the range is walked once to count it (not needed when other is this list)
+  pos must not be inside the range*/
+template<class D>
+void List<D>::splice(Node<D>* pos, List<D>& other, Node<D>* first, Node<D>* last, int count)
+{
+	if (first == nullptr || last == nullptr) return;
+	if (&other != this && count < 0) {
+		count = 1;
+		for (Node<D>* temp = first; temp != last; temp = temp->next) {
+			count++;
+		}
+	}
+	//detach the range from other
+	(first->prev)->next = last->next;
+	(last->next)->prev = first->prev;
+	//link the range before pos
+	first->prev = pos->prev;
+	last->next = pos;
+	(pos->prev)->next = first;
+	pos->prev = last;
+	if (&other != this) {
+		other.size -= count;
+		size += count;
+	}
+}
+
+/*merges other into this list, both must be sorted by operator<
+  equal elements of this list stay before the ones of other*/
+template<class D>
+void List<D>::merge(List<D>& other)
+{
+	if (&other == this || other.size == 0) return;
+	Node<D>* current = head->next;
+	Node<D>* to_move = (other.head)->next;
+	while (to_move != other.tail) {
+		if (current == tail || to_move->data < current->data) {
+			Node<D>* temp = to_move->next;
+			to_move->prev = current->prev;
+			to_move->next = current;
+			(current->prev)->next = to_move;
+			current->prev = to_move;
+			to_move = temp; //iteration
+		}
+		else {
+			current = current->next; //iteration
+		}
+	}
+	size += other.size;
+	(other.head)->next = other.tail;
+	(other.tail)->prev = other.head;
+	other.size = 0;
+}
+
+/*cuts a nullptr terminated chain after n nodes and returns the rest of it*/
+template<class D>
+static Node<D>* listSplitAUX(Node<D>* chain, int n) {
+	for (int i = 1; chain != nullptr && i < n; i++) {
+		chain = chain->next;
+	}
+	if (chain == nullptr) return nullptr;
+	Node<D>* rest = chain->next;
+	chain->next = nullptr;
+	return rest;
+}
+
+/*merges two sorted nullptr terminated chains (only next ptrs are used)
+  returns the merged chain and sets last to its last node*/
+template<class D>
+static Node<D>* listMergeAUX(Node<D>* a, Node<D>* b, Node<D>** last) {
+	Node<D>* merged = nullptr;
+	Node<D>** link = &merged;
+	while (a != nullptr && b != nullptr) {
+		if (b->data < a->data) {
+			*link = b;
+			b = b->next;
+		}
+		else {
+			*link = a;
+			a = a->next;
+		}
+		link = &((*link)->next);
+	}
+	*link = (a != nullptr) ? a : b;
+	while ((*link) != nullptr) {
+		*last = *link;
+		link = &((*link)->next);
+	}
+	return merged;
+}
+
+/*bottom up merge sort - the list is treated as a singly linked chain while sorting
+  and the prev ptrs are fixed in one pass at the end*/
+template<class D>
+void List<D>::sort()
+{
+	if (size < 2) return;
+	Node<D>* chain = head->next;
+	(tail->prev)->next = nullptr;
+	Node<D>* last = nullptr;
+	for (int width = 1; width < size; width *= 2) {
+		Node<D>* sorted = nullptr;
+		Node<D>* sorted_last = nullptr;
+		Node<D>* current = chain;
+		while (current != nullptr) {
+			Node<D>* left = current;
+			Node<D>* right = listSplitAUX(left, width);
+			current = listSplitAUX(right, width);
+			Node<D>* merged = listMergeAUX(left, right, &last);
+			if (sorted == nullptr) {
+				sorted = merged;
+			}
+			else {
+				sorted_last->next = merged;
+			}
+			sorted_last = last;
+		}
+		chain = sorted;
+	}
+	//fix prev ptrs and the dummy nodes
+	Node<D>* prev = head;
+	for (Node<D>* temp = chain; temp != nullptr; temp = temp->next) {
+		prev->next = temp;
+		temp->prev = prev;
+		prev = temp;
+	}
+	prev->next = tail;
+	tail->prev = prev;
+}
+
+template<class D>
+void List<D>::clear()
+{
+	Node<D>* temp = head->next;
+	while (temp != tail) {
+		Node<D>* temp_next = temp->next;
+		destroyObject(resource, temp);
+		temp = temp_next; //iteration
+	}
+	head->next = tail;
+	tail->prev = head;
+	size = 0;
 }
 
 #endif // !LIST_H
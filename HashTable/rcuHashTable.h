@@ -0,0 +1,408 @@
+#ifndef RCU_HASHTABLE_H
+#define RCU_HASHTABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include "../MemoryResource.h"
+#define RCU_MIN_SIZE 5 //same first size as HashTable
+#define RCU_MAX_READERS 64
+
+#ifndef CACHE_LINE
+#define CACHE_LINE 64
+#endif
+
+/* read-copy-update HashTable for read mostly data (configs, routing tables) - readers take no lock and
+* never write memory another thread writes, so they scale with the number of cores. writers are serialized
+* by a mutex and never change anything a reader may be looking at in place:
+* insert: the new node is fully built and then published at the front of its chain with one atomic store
+* remove: the node is unlinked with one store, readers already on it still see a valid next pointer
+* replace: a new node takes the old one's place in the chain with one store
+* rehash: a whole new bucket array with copies of the nodes is built and published by swapping the table
+*         pointer (HashTable moves its nodes between chains, which a reader in the middle of a walk would miss)
+* the unlinked nodes and old bucket arrays are retired and only freed once every reader that could still
+* hold them has left its read section (epoch based reclamation - see readLock).
+* readers register once per thread, then wrap every group of lookups in readLock/readUnlock (or RcuReadGuard).
+* same element requirements as HashTable (operator() returns the key, operator== compares) plus T must be
+* copyable, and the same modulo hash, so keys must not be negative*/
+template<class T>
+class RcuHashTable {
+    struct RcuNode {
+        T data; //never changes once the node is published
+        std::atomic<RcuNode*> next;
+        RcuNode* retired_next;
+        uint64_t retired_epoch;
+
+        RcuNode(const T& _data, RcuNode* _next) : data(_data), next(_next), retired_next(nullptr), retired_epoch(0) {}
+    };
+
+    struct RcuTable {
+        int size;
+        std::atomic<RcuNode*>* buckets;
+        RcuTable* retired_next;
+        uint64_t retired_epoch;
+    };
+
+    /*epoch the reader entered its read section at, 0 when it is outside - one cache line per reader,
+      written only by its reader and read by writers*/
+    struct alignas(CACHE_LINE) ReaderSlot {
+        std::atomic<uint64_t> epoch;
+        std::atomic<bool> used;
+    };
+
+    std::atomic<RcuTable*> table;
+    std::atomic<int> count;
+    alignas(CACHE_LINE) std::atomic<uint64_t> epoch; //advanced by writers after every unlink
+    ReaderSlot readers[RCU_MAX_READERS];
+    std::mutex write_lock;
+    RcuNode* retired_head; //oldest first, so the epochs only grow along the lists
+    RcuNode* retired_tail;
+    RcuTable* retired_tables_head;
+    RcuTable* retired_tables_tail;
+    int pending;
+    std::pmr::memory_resource* resource;
+
+    RcuTable* createTable(int size);
+    void destroyTable(RcuTable* old, bool with_nodes);
+    int hash(const RcuTable* current, int key) const {
+        return key % current->size;
+    }
+    std::atomic<RcuNode*>* linkOf(RcuTable* current, const T& element, int key); //link that points to the equal node
+    void retire(RcuNode* node);
+    void retire(RcuTable* old);
+    void rehash(); //writers only
+    void reclaim(); //writers only, frees what no reader can reach anymore
+
+public:
+    explicit RcuHashTable(std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+    ~RcuHashTable(); //no reader may be inside a read section
+    RcuHashTable(const RcuHashTable<T>& table) = delete;
+    RcuHashTable<T>& operator=(const RcuHashTable<T>& table) = delete;
+
+    /*readers*/
+    int registerReader(); //once per thread, returns the reader's slot or -1 if all RCU_MAX_READERS are taken
+    void unregisterReader(int reader);
+    void readLock(int reader); //read sections do not nest
+    void readUnlock(int reader);
+    const T* find(const T& element, int key) const; //inside a read section only, the pointer is valid until readUnlock
+    bool get(int reader, const T& element, int key, T& out); //a whole read section around find, copies the element
+
+    /*writers - safe to call from any thread at the same time as the readers, but not from inside a read section*/
+    bool insert(const T& element, int key); //false if the element already exists
+    bool replace(const T& element, int key); //inserts, or publishes element in place of the equal one
+    bool remove(const T& element, int key); //false if not found
+    void synchronize(); //waits until every retired node and table is freed
+
+    int getSize() const {
+        return table.load(std::memory_order_acquire)->size;
+    }
+    int getCount() const {
+        return count.load(std::memory_order_relaxed);
+    }
+    int getPending(); //retired nodes and tables that are not freed yet
+};
+
+/*keeps a read section open for its scope*/
+template<class T>
+class RcuReadGuard {
+    RcuHashTable<T>& table;
+    int reader;
+
+public:
+    RcuReadGuard(RcuHashTable<T>& _table, int _reader) : table(_table), reader(_reader) {
+        table.readLock(reader);
+    }
+    ~RcuReadGuard() {
+        table.readUnlock(reader);
+    }
+    RcuReadGuard(const RcuReadGuard<T>& guard) = delete;
+    RcuReadGuard<T>& operator=(const RcuReadGuard<T>& guard) = delete;
+};
+
+/***********************FUNCTION IMPLEMENTATIONS*******************/
+template<class T>
+RcuHashTable<T>::RcuHashTable(std::pmr::memory_resource* _resource)
+    : count(0), epoch(1), retired_head(nullptr), retired_tail(nullptr), retired_tables_head(nullptr),
+    retired_tables_tail(nullptr), pending(0), resource(_resource) {
+    for (int i = 0; i < RCU_MAX_READERS; i++) {
+        readers[i].epoch.store(0, std::memory_order_relaxed);
+        readers[i].used.store(false, std::memory_order_relaxed);
+    }
+    table.store(createTable(RCU_MIN_SIZE), std::memory_order_release);
+}
+
+template<class T>
+RcuHashTable<T>::~RcuHashTable() {
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+    reclaim(); //with no reader left everything retired goes
+    destroyTable(table.load(std::memory_order_relaxed), true);
+}
+
+template<class T>
+typename RcuHashTable<T>::RcuTable* RcuHashTable<T>::createTable(int size)
+{
+    RcuTable* created = createObject<RcuTable>(resource);
+    created->size = size;
+    created->buckets = allocateArray<std::atomic<RcuNode*>>(resource, size);
+    for (int i = 0; i < size; i++) {
+        new (&created->buckets[i]) std::atomic<RcuNode*>(nullptr);
+    }
+    created->retired_next = nullptr;
+    created->retired_epoch = 0;
+    return created;
+}
+
+/*with_nodes: the nodes still linked in the table go too (an old table after a rehash holds the only
+  pointers to them, the new table has copies)*/
+template<class T>
+void RcuHashTable<T>::destroyTable(RcuTable* old, bool with_nodes)
+{
+    if (with_nodes) {
+        for (int i = 0; i < old->size; i++) {
+            RcuNode* node = old->buckets[i].load(std::memory_order_relaxed);
+            while (node != nullptr) {
+                RcuNode* next = node->next.load(std::memory_order_relaxed);
+                destroyObject(resource, node);
+                node = next;
+            }
+        }
+    }
+    deallocateArray(resource, old->buckets, old->size);
+    destroyObject(resource, old);
+}
+
+template<class T>
+int RcuHashTable<T>::registerReader()
+{
+    for (int i = 0; i < RCU_MAX_READERS; i++) {
+        bool expected = false;
+        if (!readers[i].used.load(std::memory_order_relaxed) &&
+            readers[i].used.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+template<class T>
+void RcuHashTable<T>::unregisterReader(int reader)
+{
+    readers[reader].epoch.store(0, std::memory_order_release);
+    readers[reader].used.store(false, std::memory_order_release);
+}
+
+/*the fence pairs with the one in retire: either the writer sees this reader's epoch and waits for it,
+  or the reader sees everything the writer unlinked before it (and can not reach the retired memory)*/
+template<class T>
+void RcuHashTable<T>::readLock(int reader)
+{
+    readers[reader].epoch.store(epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+template<class T>
+void RcuHashTable<T>::readUnlock(int reader)
+{
+    readers[reader].epoch.store(0, std::memory_order_release); //the reads of the section happen before it
+}
+
+template<class T>
+const T* RcuHashTable<T>::find(const T& element, int key) const
+{
+    const RcuTable* current = table.load(std::memory_order_acquire);
+    RcuNode* node = current->buckets[hash(current, key)].load(std::memory_order_acquire);
+    for (; node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+        if (node->data == element)
+            return &node->data;
+    }
+    return nullptr;
+}
+
+template<class T>
+bool RcuHashTable<T>::get(int reader, const T& element, int key, T& out)
+{
+    RcuReadGuard<T> guard(*this, reader);
+    const T* found = find(element, key);
+    if (found == nullptr)
+        return false;
+    out = *found;
+    return true;
+}
+
+/*nullptr if not found*/
+template<class T>
+std::atomic<typename RcuHashTable<T>::RcuNode*>* RcuHashTable<T>::linkOf(RcuTable* current, const T& element, int key)
+{
+    std::atomic<RcuNode*>* link = &current->buckets[hash(current, key)];
+    for (RcuNode* node = link->load(std::memory_order_relaxed); node != nullptr; node = link->load(std::memory_order_relaxed)) {
+        if (node->data == element)
+            return link;
+        link = &node->next;
+    }
+    return nullptr;
+}
+
+/*the release store publishes the node together with its data*/
+template<class T>
+bool RcuHashTable<T>::insert(const T& element, int key)
+{
+    std::lock_guard<std::mutex> guard(write_lock);
+    RcuTable* current = table.load(std::memory_order_relaxed);
+    if (linkOf(current, element, key) != nullptr)
+        return false;
+    std::atomic<RcuNode*>& head = current->buckets[hash(current, key)];
+    head.store(createObject<RcuNode>(resource, element, head.load(std::memory_order_relaxed)), std::memory_order_release);
+    count.fetch_add(1, std::memory_order_relaxed);
+    rehash();
+    reclaim();
+    return true;
+}
+
+template<class T>
+bool RcuHashTable<T>::replace(const T& element, int key)
+{
+    std::lock_guard<std::mutex> guard(write_lock);
+    RcuTable* current = table.load(std::memory_order_relaxed);
+    std::atomic<RcuNode*>* link = linkOf(current, element, key);
+    if (link == nullptr) {
+        std::atomic<RcuNode*>& head = current->buckets[hash(current, key)];
+        head.store(createObject<RcuNode>(resource, element, head.load(std::memory_order_relaxed)), std::memory_order_release);
+        count.fetch_add(1, std::memory_order_relaxed);
+        rehash();
+    }
+    else { //readers see either the old or the new node, never a mix
+        RcuNode* old = link->load(std::memory_order_relaxed);
+        link->store(createObject<RcuNode>(resource, element, old->next.load(std::memory_order_relaxed)), std::memory_order_release);
+        retire(old);
+    }
+    reclaim();
+    return true;
+}
+
+/*the removed node keeps its next pointer, so a reader standing on it still reaches the rest of the chain*/
+template<class T>
+bool RcuHashTable<T>::remove(const T& element, int key)
+{
+    std::lock_guard<std::mutex> guard(write_lock);
+    std::atomic<RcuNode*>* link = linkOf(table.load(std::memory_order_relaxed), element, key);
+    if (link == nullptr)
+        return false;
+    RcuNode* removed = link->load(std::memory_order_relaxed);
+    link->store(removed->next.load(std::memory_order_relaxed), std::memory_order_release);
+    retire(removed);
+    count.fetch_add(-1, std::memory_order_relaxed);
+    rehash();
+    reclaim();
+    return true;
+}
+
+/*same grow and shrink points as HashTable::rehash with the default HashLoadPolicy*/
+template<class T>
+void RcuHashTable<T>::rehash()
+{
+    RcuTable* old = table.load(std::memory_order_relaxed);
+    int size = old->size;
+    int elements = count.load(std::memory_order_relaxed);
+    if (size == elements) {
+        size = (size * 2) + 1;
+    }
+    else if (size >= elements * 4 && (size - 1) / 2 >= RCU_MIN_SIZE) {
+        size = (size - 1) / 2;
+    }
+    else {
+        return;
+    }
+    RcuTable* fresh = createTable(size);
+    for (int i = 0; i < old->size; i++) {
+        for (RcuNode* node = old->buckets[i].load(std::memory_order_relaxed); node != nullptr;
+            node = node->next.load(std::memory_order_relaxed)) {
+            std::atomic<RcuNode*>& head = fresh->buckets[hash(fresh, node->data())];
+            head.store(createObject<RcuNode>(resource, node->data, head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        }
+    }
+    table.store(fresh, std::memory_order_release); //publishes the whole table at once
+    retire(old);
+}
+
+/*tags the memory with the epoch that starts after its unlink, readers that enter from then on can not
+  reach it. the fence pairs with the one in readLock*/
+template<class T>
+void RcuHashTable<T>::retire(RcuNode* node)
+{
+    node->retired_epoch = epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (retired_tail == nullptr)
+        retired_head = node;
+    else
+        retired_tail->retired_next = node;
+    retired_tail = node;
+    pending++;
+}
+
+template<class T>
+void RcuHashTable<T>::retire(RcuTable* old)
+{
+    old->retired_epoch = epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (retired_tables_tail == nullptr)
+        retired_tables_head = old;
+    else
+        retired_tables_tail->retired_next = old;
+    retired_tables_tail = old;
+    pending++;
+}
+
+/*memory retired at epoch e is unreachable once no reader is still in a section that entered before e*/
+template<class T>
+void RcuHashTable<T>::reclaim()
+{
+    if (pending == 0)
+        return;
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < RCU_MAX_READERS; i++) {
+        uint64_t entered = readers[i].epoch.load(std::memory_order_acquire);
+        if (entered != 0 && entered < oldest)
+            oldest = entered;
+    }
+    while (retired_head != nullptr && retired_head->retired_epoch <= oldest) {
+        RcuNode* node = retired_head;
+        retired_head = node->retired_next;
+        destroyObject(resource, node);
+        pending--;
+    }
+    if (retired_head == nullptr)
+        retired_tail = nullptr;
+    while (retired_tables_head != nullptr && retired_tables_head->retired_epoch <= oldest) {
+        RcuTable* old = retired_tables_head;
+        retired_tables_head = old->retired_next;
+        destroyTable(old, true);
+        pending--;
+    }
+    if (retired_tables_head == nullptr)
+        retired_tables_tail = nullptr;
+}
+
+template<class T>
+void RcuHashTable<T>::synchronize()
+{
+    while (true) {
+        {
+            std::lock_guard<std::mutex> guard(write_lock);
+            reclaim();
+            if (pending == 0)
+                return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+template<class T>
+int RcuHashTable<T>::getPending()
+{
+    std::lock_guard<std::mutex> guard(write_lock);
+    return pending;
+}
+
+#endif // !RCU_HASHTABLE_H
@@ -0,0 +1,147 @@
+#ifndef STATIC_HASHTABLE_H
+#define STATIC_HASHTABLE_H
+
+#include <cstdint>
+
+/*smallest power of two >= n*/
+constexpr int staticBucketsAUX(int n) {
+    int buckets = 1;
+    while (buckets < n) {
+        buckets *= 2;
+    }
+    return buckets;
+}
+
+/* fixed capacity HashTable with inline storage - no heap, no resource and no rehashing, so it can live on the
+* stack or in a constexpr table. same chain hashing and element requirements as HashTable (operator() returns
+* the key, operator== compares), but:
+* elements: a pool of Cap slots, the chains are index links through it (removed slots are reused first)
+* heads: the first slot of every chain. the bucket count is the power of two >= Cap chosen at compile time,
+*        so a hash is a multiply and a mask instead of HashTable's modulo
+* every function is constexpr - with a literal T the table can be built in a constexpr lambda and searched
+* at compile time (see find(int key))*/
+template<class T, int Cap>
+class StaticHashTable {
+    static_assert(Cap > 0, "StaticHashTable needs a positive capacity");
+    static constexpr int BUCKETS = staticBucketsAUX(Cap);
+
+    T elements[Cap];
+    int next[Cap]; //next slot of the chain (or of the free list) + 1, 0 ends it
+    int heads[BUCKETS]; //first slot of the chain + 1, 0 = empty bucket
+    int used; //slots handed out at least once, the rest were never touched
+    int free_head; //first removed slot + 1
+    int count;
+
+    constexpr int findSlot(const T& element, int key) const; //-1 if not found
+
+public:
+    constexpr StaticHashTable() : elements{}, next{}, heads{}, used(0), free_head(0), count(0) {} //braces, gcc does not treat elements() as constant
+    constexpr int hash(int key) const {
+        uint32_t h = (uint32_t)key * 0x9e3779b9u; //spreads strided keys over the low bits before masking
+        return (int)((h ^ (h >> 16)) & (BUCKETS - 1));
+    }
+    constexpr T* insert(const T& element, int key); //nullptr if the element already exists or the table is full
+    constexpr bool remove(const T& element, int key); //false if not found
+    constexpr T* find(const T& element, int key) {
+        int slot = findSlot(element, key);
+        return slot < 0 ? nullptr : &elements[slot];
+    }
+    constexpr const T* find(const T& element, int key) const {
+        int slot = findSlot(element, key);
+        return slot < 0 ? nullptr : &elements[slot];
+    }
+    constexpr const T* find(int key) const; //first element of the chain whose operator() returns key
+    constexpr int getCount() const {
+        return count;
+    }
+    static constexpr int getSize() { //number of buckets, like HashTable::getSize
+        return BUCKETS;
+    }
+    static constexpr int getCapacity() {
+        return Cap;
+    }
+    constexpr bool isFull() const {
+        return count == Cap;
+    }
+    constexpr void clear();
+};
+
+/*the new element is pushed in front of its chain like in Chain::insertElement*/
+template<class T, int Cap>
+constexpr T* StaticHashTable<T, Cap>::insert(const T& element, int key)
+{
+    if (findSlot(element, key) >= 0 || count == Cap)
+        return nullptr;
+    int slot = used; //constexpr locals must be initialized
+    if (free_head != 0) {
+        slot = free_head - 1;
+        free_head = next[slot];
+    }
+    else {
+        used++;
+    }
+    elements[slot] = element;
+    int bucket = hash(key);
+    next[slot] = heads[bucket];
+    heads[bucket] = slot + 1;
+    count++;
+    return &elements[slot];
+}
+
+template<class T, int Cap>
+constexpr bool StaticHashTable<T, Cap>::remove(const T& element, int key)
+{
+    int bucket = hash(key);
+    int* link = &heads[bucket];
+    while (*link != 0) {
+        int slot = *link - 1;
+        if (elements[slot] == element) {
+            *link = next[slot];
+            elements[slot] = T(); //lets go of whatever the element holds
+            next[slot] = free_head;
+            free_head = slot + 1;
+            count--;
+            return true;
+        }
+        link = &next[slot];
+    }
+    return false;
+}
+
+template<class T, int Cap>
+constexpr int StaticHashTable<T, Cap>::findSlot(const T& element, int key) const
+{
+    for (int link = heads[hash(key)]; link != 0; link = next[link - 1]) {
+        if (elements[link - 1] == element) {
+            return link - 1;
+        }
+    }
+    return -1;
+}
+
+template<class T, int Cap>
+constexpr const T* StaticHashTable<T, Cap>::find(int key) const
+{
+    for (int link = heads[hash(key)]; link != 0; link = next[link - 1]) {
+        if (elements[link - 1]() == key) {
+            return &elements[link - 1];
+        }
+    }
+    return nullptr;
+}
+
+template<class T, int Cap>
+constexpr void StaticHashTable<T, Cap>::clear()
+{
+    for (int i = 0; i < BUCKETS; i++) {
+        heads[i] = 0;
+    }
+    for (int i = 0; i < used; i++) {
+        elements[i] = T();
+    }
+    used = 0;
+    free_head = 0;
+    count = 0;
+}
+
+#endif // !STATIC_HASHTABLE_H
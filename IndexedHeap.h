@@ -0,0 +1,308 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <functional>
+#include <new>
+#include <utility>
+#include "vector.h"
+#include "MemoryResource.h"
+
+/*d-ary indexed min heap (by Less) - a priority queue whose elements can be changed or erased by handle.
+* push returns a handle, and position[handle] says where that handle currently sits in the heap,
+* so decreaseKey/update/erase find their slot in O(1) and fix the heap in O(log_D n).
+* the (priority, handle) slots are kept inline in one contiguous array, so with D = 4 all the children
+* compared during a sift down usually share one or two cache lines. the array grows by doubling like Vector.
+* build() heapifies a bulk load taken from a Vector in O(n)*/
+
+template<class P, int D = 4, class Less = std::less<P>>
+class IndexedHeap {
+	struct HeapSlot {
+		P priority;
+		int handle;
+	};
+
+	HeapSlot* slots;
+	int* position; //position[handle] = index in slots, -1 if the handle is not in the heap
+	int* free_handles; //stack of handles that can be reused
+	int size;
+	int capacity;
+	int next_handle; //handles below this one have been given out at least once
+	int free_count;
+	Less less;
+	std::pmr::memory_resource* resource;
+
+	void grow();
+	void place(HeapSlot&& slot, int index) { //moves slot into an empty index and updates the position map
+		new (&slots[index]) HeapSlot(std::move(slot));
+		position[slots[index].handle] = index;
+	}
+	void siftUp(int index);
+	void siftDown(int index);
+	void removeAt(int index);
+	template<class PP>
+	int pushAUX(PP&& priority);
+
+public:
+	explicit IndexedHeap(int initial_capacity = N, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	~IndexedHeap();
+	IndexedHeap(const IndexedHeap& heap) = delete;
+	IndexedHeap& operator=(const IndexedHeap& heap) = delete;
+	int push(const P& priority); //returns the handle of the new element
+	int push(P&& priority);
+	const P& top(); //the heap must not be empty
+	int topHandle(); //-1 if empty
+	int pop(); //removes the top, returns its handle (-1 if empty)
+	bool decreaseKey(int handle, const P& priority); //false if handle isnt in the heap or priority isnt smaller
+	bool update(int handle, const P& priority); //any change, sifts in the needed direction
+	bool erase(int handle);
+	bool contains(int handle);
+	const P& getPriority(int handle); //handle must be in the heap
+	void build(Vector<P>& items, int count); //replaces the content, items[i] gets handle i
+	int getSize();
+	bool isEmpty();
+	void clear();
+};
+
+/*INDEXED HEAP IMPLEMENTATIONS*/
+template<class P, int D, class Less>
+IndexedHeap<P, D, Less>::IndexedHeap(int initial_capacity, std::pmr::memory_resource* _resource)
+	: size(0), capacity(initial_capacity > 0 ? initial_capacity : 1), next_handle(0), free_count(0),
+	resource(_resource)
+{
+	slots = allocateArray<HeapSlot>(resource, capacity);
+	position = allocateArray<int>(resource, capacity);
+	free_handles = allocateArray<int>(resource, capacity);
+}
+
+template<class P, int D, class Less>
+IndexedHeap<P, D, Less>::~IndexedHeap()
+{
+	clear();
+	deallocateArray(resource, slots, capacity);
+	deallocateArray(resource, position, capacity);
+	deallocateArray(resource, free_handles, capacity);
+}
+
+/*doubles all three arrays - there are never more handles than slots, since freed handles are reused*/
+template<class P, int D, class Less>
+void IndexedHeap<P, D, Less>::grow()
+{
+	int new_capacity = capacity * 2;
+	HeapSlot* new_slots = allocateArray<HeapSlot>(resource, new_capacity);
+	int* new_position = allocateArray<int>(resource, new_capacity);
+	int* new_free = allocateArray<int>(resource, new_capacity);
+	for (int i = 0; i < size; i++) {
+		new (&new_slots[i]) HeapSlot(std::move(slots[i]));
+		slots[i].~HeapSlot();
+	}
+	for (int i = 0; i < next_handle; i++) {
+		new_position[i] = position[i];
+	}
+	for (int i = 0; i < free_count; i++) {
+		new_free[i] = free_handles[i];
+	}
+	deallocateArray(resource, slots, capacity);
+	deallocateArray(resource, position, capacity);
+	deallocateArray(resource, free_handles, capacity);
+	slots = new_slots;
+	position = new_position;
+	free_handles = new_free;
+	capacity = new_capacity;
+}
+
+/*hole technique - the moving slot is held aside and parents are moved down into the hole*/
+template<class P, int D, class Less>
+void IndexedHeap<P, D, Less>::siftUp(int index)
+{
+	HeapSlot moving(std::move(slots[index]));
+	slots[index].~HeapSlot();
+	while (index > 0) {
+		int parent = (index - 1) / D;
+		if (!less(moving.priority, slots[parent].priority)) break;
+		place(std::move(slots[parent]), index);
+		slots[parent].~HeapSlot();
+		index = parent;
+	}
+	place(std::move(moving), index);
+}
+
+template<class P, int D, class Less>
+void IndexedHeap<P, D, Less>::siftDown(int index)
+{
+	HeapSlot moving(std::move(slots[index]));
+	slots[index].~HeapSlot();
+	while (true) {
+		int first = D * index + 1;
+		if (first >= size) break;
+		int last = first + D < size ? first + D : size;
+		int best = first;
+		for (int child = first + 1; child < last; child++) { //the D children are adjacent in memory
+			if (less(slots[child].priority, slots[best].priority)) best = child;
+		}
+		if (!less(slots[best].priority, moving.priority)) break;
+		place(std::move(slots[best]), index);
+		slots[best].~HeapSlot();
+		index = best;
+	}
+	place(std::move(moving), index);
+}
+
+/*the last slot fills the hole and is sifted whichever way it needs to go*/
+template<class P, int D, class Less>
+void IndexedHeap<P, D, Less>::removeAt(int index)
+{
+	int handle = slots[index].handle;
+	position[handle] = -1;
+	free_handles[free_count++] = handle;
+	slots[index].~HeapSlot();
+	size--;
+	if (index == size) return;
+	place(std::move(slots[size]), index);
+	slots[size].~HeapSlot();
+	if (index > 0 && less(slots[index].priority, slots[(index - 1) / D].priority)) {
+		siftUp(index);
+	}
+	else {
+		siftDown(index);
+	}
+}
+
+template<class P, int D, class Less>
+int IndexedHeap<P, D, Less>::push(const P& priority)
+{
+	return pushAUX(priority);
+}
+
+template<class P, int D, class Less>
+int IndexedHeap<P, D, Less>::push(P&& priority)
+{
+	return pushAUX(std::move(priority));
+}
+
+template<class P, int D, class Less>
+template<class PP>
+int IndexedHeap<P, D, Less>::pushAUX(PP&& priority)
+{
+	if (size == capacity) {
+		grow();
+	}
+	int handle = free_count > 0 ? free_handles[--free_count] : next_handle++;
+	HeapSlot slot = { std::forward<PP>(priority), handle };
+	place(std::move(slot), size);
+	size++;
+	siftUp(size - 1);
+	return handle;
+}
+
+template<class P, int D, class Less>
+const P& IndexedHeap<P, D, Less>::top()
+{
+	return slots[0].priority;
+}
+
+template<class P, int D, class Less>
+int IndexedHeap<P, D, Less>::topHandle()
+{
+	return size > 0 ? slots[0].handle : -1;
+}
+
+template<class P, int D, class Less>
+int IndexedHeap<P, D, Less>::pop()
+{
+	if (size == 0) return -1;
+	int handle = slots[0].handle;
+	removeAt(0);
+	return handle;
+}
+
+template<class P, int D, class Less>
+bool IndexedHeap<P, D, Less>::decreaseKey(int handle, const P& priority)
+{
+	if (!contains(handle)) return false;
+	int index = position[handle];
+	if (!less(priority, slots[index].priority)) return false;
+	slots[index].priority = priority;
+	siftUp(index);
+	return true;
+}
+
+template<class P, int D, class Less>
+bool IndexedHeap<P, D, Less>::update(int handle, const P& priority)
+{
+	if (!contains(handle)) return false;
+	int index = position[handle];
+	bool smaller = less(priority, slots[index].priority);
+	slots[index].priority = priority;
+	if (smaller) {
+		siftUp(index);
+	}
+	else {
+		siftDown(index);
+	}
+	return true;
+}
+
+template<class P, int D, class Less>
+bool IndexedHeap<P, D, Less>::erase(int handle)
+{
+	if (!contains(handle)) return false;
+	removeAt(position[handle]);
+	return true;
+}
+
+template<class P, int D, class Less>
+bool IndexedHeap<P, D, Less>::contains(int handle)
+{
+	return handle >= 0 && handle < next_handle && position[handle] >= 0;
+}
+
+template<class P, int D, class Less>
+const P& IndexedHeap<P, D, Less>::getPriority(int handle)
+{
+	return slots[position[handle]].priority;
+}
+
+/*Floyd's heapify - sifts down every inner slot from the last one up, O(n) in total*/
+template<class P, int D, class Less>
+void IndexedHeap<P, D, Less>::build(Vector<P>& items, int count)
+{
+	clear();
+	while (capacity < count) {
+		grow();
+	}
+	for (int i = 0; i < count; i++) {
+		HeapSlot slot = { items[i], i };
+		place(std::move(slot), i);
+	}
+	size = count;
+	next_handle = count;
+	for (int i = (count - 2) / D; i >= 0 && count > 1; i--) {
+		siftDown(i);
+	}
+}
+
+template<class P, int D, class Less>
+int IndexedHeap<P, D, Less>::getSize()
+{
+	return size;
+}
+
+template<class P, int D, class Less>
+bool IndexedHeap<P, D, Less>::isEmpty()
+{
+	return size == 0;
+}
+
+/*empties the heap and forgets all handles*/
+template<class P, int D, class Less>
+void IndexedHeap<P, D, Less>::clear()
+{
+	for (int i = 0; i < size; i++) {
+		slots[i].~HeapSlot();
+	}
+	size = 0;
+	next_handle = 0;
+	free_count = 0;
+}
+
+#endif // !INDEXED_HEAP_H
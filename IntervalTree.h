@@ -0,0 +1,151 @@
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <algorithm>
+#include <iostream>
+#include "AVLtree.h"
+
+/*closed interval [low, high] used as an AVLtree key - ordered by low and then by high.
+  max_high is the largest high in the subtree of the node that holds the key, it is kept by
+  SubtreeAugment below and never takes part in comparisons*/
+template<class E>
+class IntervalKey {
+public:
+	E low;
+	E high;
+	E max_high;
+
+	IntervalKey() : low(), high(), max_high() {}
+	IntervalKey(E _low, E _high) : low(_low), high(_high), max_high(_high) {}
+
+	bool overlaps(E _low, E _high) const {
+		return low <= _high && _low <= high;
+	}
+	bool operator==(const IntervalKey<E>& other) const {
+		return low == other.low && high == other.high;
+	}
+	bool operator!=(const IntervalKey<E>& other) const {
+		return !(*this == other);
+	}
+	bool operator<(const IntervalKey<E>& other) const {
+		return low < other.low || (low == other.low && high < other.high);
+	}
+	bool operator>(const IntervalKey<E>& other) const {
+		return other < *this;
+	}
+};
+
+template<class E>
+std::ostream& operator<<(std::ostream& os, const IntervalKey<E>& key) {
+	return os << "[" << key.low << "," << key.high << "]";
+}
+
+template<class E>
+struct SubtreeAugment<IntervalKey<E>> {
+	template<class V>
+	static void update(Tnode<IntervalKey<E>, V>* node) {
+		E max_high = node->key.high;
+		if (node->left != nullptr && max_high < node->left->key.max_high) {
+			max_high = node->left->key.max_high;
+		}
+		if (node->right != nullptr && max_high < node->right->key.max_high) {
+			max_high = node->right->key.max_high;
+		}
+		node->key.max_high = max_high;
+	}
+};
+
+/*interval tree - an AVLtree keyed by intervals whose nodes know the max endpoint of their subtree,
+* so a query skips every subtree that ends before it starts and every right subtree that starts after it ends.
+* reporting k overlaps costs O(log n) when k = 0 and O(min(n, k log n)) in general.
+* an interval can be stored once, inserting the same [low, high] again returns the existing node*/
+template<class E, class V>
+class IntervalTree : public AVLtree<IntervalKey<E>, V> {
+	typedef Tnode<IntervalKey<E>, V> Node;
+
+	template<class Visit>
+	static int overlapsAUX(Node* node, E low, E high, Visit& visit);
+
+public:
+	explicit IntervalTree(std::pmr::memory_resource* _resource = std::pmr::get_default_resource())
+		: AVLtree<IntervalKey<E>, V>(_resource) {}
+	Node* insert(E low, E high, V value);
+	bool remove(E low, E high);
+	Node* find(E low, E high);
+	template<class Visit>
+	int overlaps(E low, E high, Visit visit); //visit(const IntervalKey<E>&, V&) per overlap, returns the count
+	template<class Visit>
+	int stab(E point, Visit visit); //intervals that contain point
+	template<class Visit>
+	int overlapsBatch(const IntervalKey<E>* queries, int count, Visit visit); //visit(query index, key, value)
+};
+
+template<class E, class V>
+Tnode<IntervalKey<E>, V>* IntervalTree<E, V>::insert(E low, E high, V value)
+{
+	return AVLtree<IntervalKey<E>, V>::insert(IntervalKey<E>(low, high), std::move(value));
+}
+
+template<class E, class V>
+bool IntervalTree<E, V>::remove(E low, E high)
+{
+	return AVLtree<IntervalKey<E>, V>::remove(IntervalKey<E>(low, high), this->getRoot());
+}
+
+template<class E, class V>
+Tnode<IntervalKey<E>, V>* IntervalTree<E, V>::find(E low, E high)
+{
+	return AVLtree<IntervalKey<E>, V>::find(IntervalKey<E>(low, high), this->getRoot());
+}
+
+/*in order, so the overlaps are reported sorted by low*/
+template<class E, class V>
+template<class Visit>
+int IntervalTree<E, V>::overlapsAUX(Node* node, E low, E high, Visit& visit)
+{
+	if (node == nullptr || node->key.max_high < low) return 0; //everything below ends before the query
+	int found = overlapsAUX(node->left, low, high, visit);
+	if (high < node->key.low) return found; //this node and its right subtree start after the query
+	if (node->key.overlaps(low, high)) {
+		visit(node->key, node->value);
+		found++;
+	}
+	return found + overlapsAUX(node->right, low, high, visit);
+}
+
+template<class E, class V>
+template<class Visit>
+int IntervalTree<E, V>::overlaps(E low, E high, Visit visit)
+{
+	return overlapsAUX(this->getRoot(), low, high, visit);
+}
+
+template<class E, class V>
+template<class Visit>
+int IntervalTree<E, V>::stab(E point, Visit visit)
+{
+	return overlapsAUX(this->getRoot(), point, point, visit);
+}
+
+/*queries run in order of their low endpoint, so consecutive searches walk mostly the same
+  (already cached) top of the tree. results are reported per query in that order*/
+template<class E, class V>
+template<class Visit>
+int IntervalTree<E, V>::overlapsBatch(const IntervalKey<E>* queries, int count, Visit visit)
+{
+	int* order = new int[count > 0 ? count : 1];
+	for (int i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	std::sort(order, order + count, [queries](int a, int b) { return queries[a].low < queries[b].low; });
+	int found = 0;
+	for (int i = 0; i < count; i++) {
+		int query = order[i];
+		auto report = [&visit, query](const IntervalKey<E>& key, V& value) { visit(query, key, value); };
+		found += overlapsAUX(this->getRoot(), queries[query].low, queries[query].high, report);
+	}
+	delete[] order;
+	return found;
+}
+
+#endif // !INTERVAL_TREE_H
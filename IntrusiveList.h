@@ -0,0 +1,234 @@
+#ifndef INTRUSIVE_LIST_H
+#define INTRUSIVE_LIST_H
+
+#include <iostream>
+
+/*NOTE: the element class must inherit from ListHook<Tag> for every list it can be linked into.
+  the tag tells the hooks apart, so the same object can be in a hash chain and in an LRU queue:
+	class Record : public ListHook<ChainTag>, public ListHook<LruTag> { ... };
+  the list never allocates, copies or deletes elements - the owner (e.g. an object pool) does*/
+
+/********************************** LIST HOOK IMPLEMENTATION **********************************/
+struct DefaultListTag {};
+
+template<class Tag = DefaultListTag>
+class ListHook {
+public:
+	ListHook* prev;
+	ListHook* next;
+
+	ListHook() : prev(nullptr), next(nullptr) {}
+
+	~ListHook() {
+		prev = nullptr;
+		next = nullptr;
+	}
+
+	//copying an element must not copy its links
+	ListHook(const ListHook<Tag>&) : prev(nullptr), next(nullptr) {}
+
+	ListHook<Tag>& operator=(const ListHook<Tag>&) {
+		return *this;
+	}
+
+	bool isLinked() const {
+		return next != nullptr;
+	}
+};
+
+/**********************************************************************************************/
+
+template<class D, class Tag = DefaultListTag>
+class IntrusiveList {
+	ListHook<Tag> head; //dummy hooks, they are never cast to D
+	ListHook<Tag> tail;
+	int size;
+
+	static ListHook<Tag>* hookOf(D* element) {
+		return static_cast<ListHook<Tag>*>(element);
+	}
+	D* elementOf(ListHook<Tag>* hook) {
+		if (hook == &head || hook == &tail) return nullptr;
+		return static_cast<D*>(hook);
+	}
+	void linkBefore(ListHook<Tag>* hook, ListHook<Tag>* insert_before);
+
+public:
+	IntrusiveList();
+	IntrusiveList(const IntrusiveList<D, Tag>& list) = delete; //elements can only be in one list per hook
+	IntrusiveList<D, Tag>& operator=(const IntrusiveList<D, Tag>& list) = delete;
+	~IntrusiveList(); //unlinks all elements, doesnt delete them
+	void insertBeforeNode(D* element, D* node);
+	void insertAfterNode(D* element, D* node);
+	void push_front(D* element);
+	void push_back(D* element);
+	D* pop_front(); //unlinks without deleting, nullptr if empty
+	D* pop_back();
+	void remove(D* element); //O(1) unlink using the element's own hook
+	void moveToFront(D* element);
+	D* find(const D& data);
+	D* begin(); //first element, nullptr if empty
+	D* end(); //last element, nullptr if empty
+	D* next(D* element); //nullptr after the last element
+	D* prev(D* element); //nullptr before the first element
+	int getSize();
+	bool isEmpty();
+	void clear(); //unlinks all elements, doesnt delete them
+};
+
+/*INTRUSIVE LIST METHODS IMPLEMENTATIONS */
+template<class D, class Tag>
+IntrusiveList<D, Tag>::IntrusiveList()
+{
+	head.prev = nullptr;
+	head.next = &tail;
+	tail.prev = &head;
+	tail.next = nullptr;
+	size = 0;
+}
+
+template<class D, class Tag>
+IntrusiveList<D, Tag>::~IntrusiveList()
+{
+	clear();
+}
+
+template<class D, class Tag>
+void IntrusiveList<D, Tag>::linkBefore(ListHook<Tag>* hook, ListHook<Tag>* insert_before)
+{
+	(insert_before->prev)->next = hook;
+	hook->prev = insert_before->prev;
+	hook->next = insert_before;
+	insert_before->prev = hook;
+	size++;
+}
+
+/*element must not be linked in another list of the same tag*/
+template<class D, class Tag>
+void IntrusiveList<D, Tag>::insertBeforeNode(D* element, D* node)
+{
+	linkBefore(hookOf(element), hookOf(node));
+}
+
+template<class D, class Tag>
+void IntrusiveList<D, Tag>::insertAfterNode(D* element, D* node)
+{
+	linkBefore(hookOf(element), hookOf(node)->next);
+}
+
+template<class D, class Tag>
+void IntrusiveList<D, Tag>::push_front(D* element)
+{
+	linkBefore(hookOf(element), head.next);
+}
+
+template<class D, class Tag>
+void IntrusiveList<D, Tag>::push_back(D* element)
+{
+	linkBefore(hookOf(element), &tail);
+}
+
+template<class D, class Tag>
+D* IntrusiveList<D, Tag>::pop_front()
+{
+	D* element = elementOf(head.next);
+	if (element != nullptr) {
+		remove(element);
+	}
+	return element;
+}
+
+template<class D, class Tag>
+D* IntrusiveList<D, Tag>::pop_back()
+{
+	D* element = elementOf(tail.prev);
+	if (element != nullptr) {
+		remove(element);
+	}
+	return element;
+}
+
+/*element must be linked in this list*/
+template<class D, class Tag>
+void IntrusiveList<D, Tag>::remove(D* element)
+{
+	ListHook<Tag>* hook = hookOf(element);
+	(hook->prev)->next = hook->next;
+	(hook->next)->prev = hook->prev;
+	hook->prev = nullptr;
+	hook->next = nullptr;
+	size--;
+}
+
+/*used for recency ordering - relinks the element right after the head*/
+template<class D, class Tag>
+void IntrusiveList<D, Tag>::moveToFront(D* element)
+{
+	ListHook<Tag>* hook = hookOf(element);
+	if (head.next == hook) return;
+	remove(element);
+	push_front(element);
+}
+
+/*returns pointer to element if found else returns nullptr*/
+template<class D, class Tag>
+D* IntrusiveList<D, Tag>::find(const D& data)
+{
+	for (ListHook<Tag>* hook = head.next; hook != &tail; hook = hook->next) {
+		if (*static_cast<D*>(hook) == data) return static_cast<D*>(hook);
+	}
+	return nullptr;
+}
+
+template<class D, class Tag>
+D* IntrusiveList<D, Tag>::begin()
+{
+	return elementOf(head.next);
+}
+
+template<class D, class Tag>
+D* IntrusiveList<D, Tag>::end()
+{
+	return elementOf(tail.prev);
+}
+
+template<class D, class Tag>
+D* IntrusiveList<D, Tag>::next(D* element)
+{
+	return elementOf(hookOf(element)->next);
+}
+
+template<class D, class Tag>
+D* IntrusiveList<D, Tag>::prev(D* element)
+{
+	return elementOf(hookOf(element)->prev);
+}
+
+template<class D, class Tag>
+int IntrusiveList<D, Tag>::getSize()
+{
+	return size;
+}
+
+template<class D, class Tag>
+bool IntrusiveList<D, Tag>::isEmpty()
+{
+	return size == 0;
+}
+
+template<class D, class Tag>
+void IntrusiveList<D, Tag>::clear()
+{
+	ListHook<Tag>* hook = head.next;
+	while (hook != &tail) {
+		ListHook<Tag>* temp = hook->next;
+		hook->prev = nullptr;
+		hook->next = nullptr;
+		hook = temp; //iteration
+	}
+	head.next = &tail;
+	tail.prev = &head;
+	size = 0;
+}
+
+#endif // !INTRUSIVE_LIST_H
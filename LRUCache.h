@@ -0,0 +1,235 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include "HashTable/hashTable.h"
+#include "IntrusiveList.h"
+
+/*sharded LRU cache - every shard is a HashTable (index by key) whose entries are also linked
+* into an IntrusiveList (recency order, most recent first). a hit relinks the entry to the front,
+* an eviction unlinks the last entry and removes it from the table, all in O(1) expected time.
+* capacity is in bytes (each put says how much its entry costs) and is split evenly between shards,
+* every shard has its own lock so threads working on different keys rarely contend*/
+
+struct LRURecencyTag {};
+
+/********************************** LRU ENTRY IMPLEMENTATION **********************************/
+template<class K, class V>
+class LRUEntry : public ListHook<LRURecencyTag> {
+public:
+	K key;
+	V value;
+	size_t bytes;
+	int hash; //HashTable key, always >= 0
+
+	LRUEntry() : key(), value(), bytes(0), hash(0) {}
+	LRUEntry(const K& _key, const V& _value, size_t _bytes, int _hash)
+		: key(_key), value(_value), bytes(_bytes), hash(_hash) {}
+	LRUEntry(const K& _key, V&& _value, size_t _bytes, int _hash)
+		: key(_key), value(std::move(_value)), bytes(_bytes), hash(_hash) {}
+
+	int operator()() const { //key used by HashTable when rehashing
+		return hash;
+	}
+
+	bool operator==(const LRUEntry<K, V>& other) const {
+		return key == other.key;
+	}
+};
+
+struct LRUStats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t count;
+	uint64_t bytes;
+};
+
+/**********************************LRU CACHE IMPLEMENTATION **********************************/
+template<class K, class V, class Hash = std::hash<K>>
+class LRUCache {
+	typedef LRUEntry<K, V> Entry;
+
+	struct Shard {
+		std::mutex lock;
+		HashTable<Entry> index;
+		IntrusiveList<Entry, LRURecencyTag> recency;
+		size_t bytes;
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+
+		explicit Shard(std::pmr::memory_resource* resource)
+			: index(resource), bytes(0), hits(0), misses(0), evictions(0) {}
+	};
+
+	Shard** shards;
+	int shard_count;
+	size_t shard_capacity;
+	Hash hasher;
+	std::pmr::memory_resource* resource;
+
+	static uint64_t mix(uint64_t h) { //spreads weak hashes (e.g. std::hash<int> is the identity)
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+	Entry* findEntry(Shard& shard, const K& key, int hash);
+	void removeEntry(Shard& shard, Entry* entry);
+	template<class VV>
+	bool putAUX(const K& key, VV&& value, size_t bytes);
+
+public:
+	LRUCache(size_t capacity_bytes, int _shard_count = 16,
+		std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	~LRUCache();
+	LRUCache(const LRUCache& cache) = delete;
+	LRUCache& operator=(const LRUCache& cache) = delete;
+	bool get(const K& key, V& value); //copies the value out and makes the entry most recent
+	bool put(const K& key, const V& value, size_t bytes = sizeof(Entry)); //false if bytes > a shard's capacity
+	bool put(const K& key, V&& value, size_t bytes = sizeof(Entry));
+	bool remove(const K& key);
+	LRUStats getStats(); //sums all shards
+	size_t getCapacity();
+};
+
+template<class K, class V, class Hash>
+LRUCache<K, V, Hash>::LRUCache(size_t capacity_bytes, int _shard_count, std::pmr::memory_resource* _resource)
+	: shard_count(_shard_count > 0 ? _shard_count : 1), resource(_resource)
+{
+	shard_capacity = capacity_bytes / shard_count;
+	shards = allocateArray<Shard*>(resource, shard_count);
+	for (int i = 0; i < shard_count; i++) {
+		shards[i] = createObject<Shard>(resource, resource);
+	}
+}
+
+template<class K, class V, class Hash>
+LRUCache<K, V, Hash>::~LRUCache()
+{
+	for (int i = 0; i < shard_count; i++) {
+		shards[i]->recency.clear(); //entries are freed by the table
+		destroyObject(resource, shards[i]);
+	}
+	deallocateArray(resource, shards, shard_count);
+}
+
+template<class K, class V, class Hash>
+LRUEntry<K, V>* LRUCache<K, V, Hash>::findEntry(Shard& shard, const K& key, int hash)
+{
+	Entry probe;
+	probe.key = key;
+	Node<Entry>* node = shard.index.find(&probe, hash);
+	return node == nullptr ? nullptr : &node->data;
+}
+
+/*unlinks from the recency list first, the table deletes the node that holds the entry*/
+template<class K, class V, class Hash>
+void LRUCache<K, V, Hash>::removeEntry(Shard& shard, Entry* entry)
+{
+	shard.recency.remove(entry);
+	shard.bytes -= entry->bytes;
+	shard.index.remove(entry, entry->hash);
+}
+
+template<class K, class V, class Hash>
+bool LRUCache<K, V, Hash>::get(const K& key, V& value)
+{
+	uint64_t h = mix(hasher(key));
+	Shard& shard = *shards[(h >> 32) % shard_count];
+	std::lock_guard<std::mutex> guard(shard.lock);
+	Entry* entry = findEntry(shard, key, (int)(h & 0x7fffffff));
+	if (entry == nullptr) {
+		shard.misses++;
+		return false;
+	}
+	shard.hits++;
+	shard.recency.moveToFront(entry);
+	value = entry->value;
+	return true;
+}
+
+template<class K, class V, class Hash>
+bool LRUCache<K, V, Hash>::put(const K& key, const V& value, size_t bytes)
+{
+	return putAUX(key, value, bytes);
+}
+
+template<class K, class V, class Hash>
+bool LRUCache<K, V, Hash>::put(const K& key, V&& value, size_t bytes)
+{
+	return putAUX(key, std::move(value), bytes);
+}
+
+/*inserts or updates the key, then evicts least recently used entries until the shard fits*/
+template<class K, class V, class Hash>
+template<class VV>
+bool LRUCache<K, V, Hash>::putAUX(const K& key, VV&& value, size_t bytes)
+{
+	if (bytes > shard_capacity) return false;
+	uint64_t h = mix(hasher(key));
+	int hash = (int)(h & 0x7fffffff);
+	Shard& shard = *shards[(h >> 32) % shard_count];
+	std::lock_guard<std::mutex> guard(shard.lock);
+	Entry* entry = findEntry(shard, key, hash);
+	if (entry != nullptr) {
+		entry->value = std::forward<VV>(value);
+		shard.bytes = shard.bytes - entry->bytes + bytes;
+		entry->bytes = bytes;
+		shard.recency.moveToFront(entry);
+	}
+	else {
+		Node<Entry>* node = shard.index.emplace(hash, key, std::forward<VV>(value), bytes, hash); //built inside the table's node
+		entry = &node->data;
+		shard.recency.push_front(entry);
+		shard.bytes += bytes;
+	}
+	while (shard.bytes > shard_capacity) {
+		Entry* last = shard.recency.end(); //never the entry just put, since it fits on its own
+		removeEntry(shard, last);
+		shard.evictions++;
+	}
+	return true;
+}
+
+template<class K, class V, class Hash>
+bool LRUCache<K, V, Hash>::remove(const K& key)
+{
+	uint64_t h = mix(hasher(key));
+	Shard& shard = *shards[(h >> 32) % shard_count];
+	std::lock_guard<std::mutex> guard(shard.lock);
+	Entry* entry = findEntry(shard, key, (int)(h & 0x7fffffff));
+	if (entry == nullptr) return false;
+	removeEntry(shard, entry);
+	return true;
+}
+
+template<class K, class V, class Hash>
+LRUStats LRUCache<K, V, Hash>::getStats()
+{
+	LRUStats stats = { 0, 0, 0, 0, 0 };
+	for (int i = 0; i < shard_count; i++) {
+		std::lock_guard<std::mutex> guard(shards[i]->lock);
+		stats.hits += shards[i]->hits;
+		stats.misses += shards[i]->misses;
+		stats.evictions += shards[i]->evictions;
+		stats.count += shards[i]->recency.getSize();
+		stats.bytes += shards[i]->bytes;
+	}
+	return stats;
+}
+
+template<class K, class V, class Hash>
+size_t LRUCache<K, V, Hash>::getCapacity()
+{
+	return shard_capacity * shard_count;
+}
+
+#endif // !LRU_CACHE_H
@@ -0,0 +1,49 @@
+#ifndef MEMORY_RESOURCE_H
+#define MEMORY_RESOURCE_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+/*every container takes a std::pmr::memory_resource in its constructor (the global heap by default)
+* and allocates all its nodes/arrays through these helpers. for example:
+*	std::pmr::monotonic_buffer_resource request_arena;  //freed all at once when the request ends
+*	AVLtree<int, int> tree(&request_arena);
+*	std::pmr::synchronized_pool_resource pool;  //long lived containers shared between threads
+*	HashTable<Record> table(&pool);
+* the resource must outlive the container. nodes moved between containers (pop_front/push_front,
+* splice, merge) must come from containers that use the same resource*/
+
+template<class T, class... Args>
+static inline T* createObject(std::pmr::memory_resource* resource, Args&&... args) {
+	void* memory = resource->allocate(sizeof(T), alignof(T));
+	try {
+		return new (memory) T(std::forward<Args>(args)...);
+	}
+	catch (...) {
+		resource->deallocate(memory, sizeof(T), alignof(T));
+		throw;
+	}
+}
+
+template<class T>
+static inline void destroyObject(std::pmr::memory_resource* resource, T* object) {
+	if (object == nullptr) return;
+	object->~T();
+	resource->deallocate(object, sizeof(T), alignof(T));
+}
+
+/*arrays are only used for pointers, so the elements are left uninitialized like new T*[n]*/
+template<class T>
+static inline T* allocateArray(std::pmr::memory_resource* resource, size_t n) {
+	return static_cast<T*>(resource->allocate(sizeof(T) * n, alignof(T)));
+}
+
+template<class T>
+static inline void deallocateArray(std::pmr::memory_resource* resource, T* arr, size_t n) {
+	if (arr == nullptr) return;
+	resource->deallocate(arr, sizeof(T) * n, alignof(T));
+}
+
+#endif // !MEMORY_RESOURCE_H
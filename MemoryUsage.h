@@ -0,0 +1,185 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+/*what a container holds, as returned by memoryUsage(). the byte counts are what the container asked its
+* resource for (plus the container object itself), a pool or arena may round them up. memory the elements
+* own themselves (a std::string's buffer...) is not included:
+* payload: the stored elements - keys and values, list data, the pointers a Vector holds
+* overhead: everything else that is in use - links, heights, node padding, sentinel nodes, chain headers,
+*           bucket cells that hold a chain, bloom filters, the container object
+* slack: allocated but holding nothing - empty Vector slots, empty HashTable bucket cells*/
+struct MemoryUsage {
+	size_t payload;
+	size_t overhead;
+	size_t slack;
+	size_t allocations; //blocks taken from the resource
+
+	size_t total() const {
+		return payload + overhead + slack;
+	}
+	MemoryUsage& operator+=(const MemoryUsage& other) {
+		payload += other.payload;
+		overhead += other.overhead;
+		slack += other.slack;
+		allocations += other.allocations;
+		return *this;
+	}
+};
+
+/*one tracked container, the registry links them together. owned by a MemoryTracker*/
+struct MemoryRegistration {
+	const char* name;
+	const void* container;
+	MemoryUsage (*measure)(const void* container);
+	MemoryRegistration* prev;
+	MemoryRegistration* next;
+};
+
+/*filled by MemoryRegistry::report, one per name*/
+struct MemoryReport {
+	const char* name;
+	int containers;
+	MemoryUsage usage;
+};
+
+/* process wide registry of tracked containers - wrap a container in a MemoryTracker under a name
+* ("sessions", "routes"...) and the registry sums memoryUsage() of every container with that name:
+*	AVLtree<int, Session> sessions;
+*	MemoryTracker<AVLtree<int, Session>> tracked(sessions, "sessions");
+*	MemoryRegistry::instance().print(); //largest first
+* registering is thread safe, but measuring walks the containers - report while their owners are not
+* modifying them*/
+class MemoryRegistry {
+	std::mutex lock;
+	MemoryRegistration* head;
+
+	MemoryRegistry() : head(nullptr) {}
+
+public:
+	MemoryRegistry(const MemoryRegistry& registry) = delete;
+	MemoryRegistry& operator=(const MemoryRegistry& registry) = delete;
+	static MemoryRegistry& instance() {
+		static MemoryRegistry registry;
+		return registry;
+	}
+	void add(MemoryRegistration* registration);
+	void remove(MemoryRegistration* registration);
+	MemoryUsage total(); //of every tracked container
+	int report(MemoryReport* out, int max); //largest total first, returns the number of names (may be > max)
+	void print(std::ostream& out = std::cout);
+};
+
+/*keeps container registered under name while it lives, name must outlive it (a string literal)*/
+template<class C>
+class MemoryTracker {
+	MemoryRegistration registration;
+
+	static MemoryUsage measureAUX(const void* container) {
+		return static_cast<const C*>(container)->memoryUsage();
+	}
+
+public:
+	MemoryTracker(const C& container, const char* name) {
+		registration = { name, &container, measureAUX, nullptr, nullptr };
+		MemoryRegistry::instance().add(&registration);
+	}
+	~MemoryTracker() {
+		MemoryRegistry::instance().remove(&registration);
+	}
+	MemoryTracker(const MemoryTracker<C>& tracker) = delete;
+	MemoryTracker<C>& operator=(const MemoryTracker<C>& tracker) = delete;
+};
+
+/***********************FUNCTION IMPLEMENTATIONS*******************/
+inline void MemoryRegistry::add(MemoryRegistration* registration)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	registration->prev = nullptr;
+	registration->next = head;
+	if (head != nullptr) {
+		head->prev = registration;
+	}
+	head = registration;
+}
+
+inline void MemoryRegistry::remove(MemoryRegistration* registration)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if (registration->prev != nullptr) {
+		registration->prev->next = registration->next;
+	}
+	else {
+		head = registration->next;
+	}
+	if (registration->next != nullptr) {
+		registration->next->prev = registration->prev;
+	}
+}
+
+inline MemoryUsage MemoryRegistry::total()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	MemoryUsage sum = {};
+	for (MemoryRegistration* current = head; current != nullptr; current = current->next) {
+		sum += current->measure(current->container);
+	}
+	return sum;
+}
+
+/*names are grouped by their text, so the same literal in two translation units is one name. the output
+  is kept sorted with an insertion sort, there are few names*/
+inline int MemoryRegistry::report(MemoryReport* out, int max)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	int names = 0;
+	for (MemoryRegistration* current = head; current != nullptr; current = current->next) {
+		bool seen = false;
+		for (MemoryRegistration* earlier = head; earlier != current && !seen; earlier = earlier->next) {
+			seen = strcmp(earlier->name, current->name) == 0;
+		}
+		if (seen) {
+			continue;
+		}
+		MemoryReport entry = { current->name, 0, {} };
+		for (MemoryRegistration* same = current; same != nullptr; same = same->next) {
+			if (strcmp(same->name, current->name) == 0) {
+				entry.containers++;
+				entry.usage += same->measure(same->container);
+			}
+		}
+		int i = names < max ? names : max;
+		while (i > 0 && out[i - 1].usage.total() < entry.usage.total()) {
+			if (i < max) {
+				out[i] = out[i - 1];
+			}
+			i--;
+		}
+		if (i < max) {
+			out[i] = entry;
+		}
+		names++;
+	}
+	return names;
+}
+
+inline void MemoryRegistry::print(std::ostream& out)
+{
+	MemoryReport reports[32];
+	int names = report(reports, 32);
+	out << "name containers payload overhead slack total" << std::endl;
+	for (int i = 0; i < names && i < 32; i++) {
+		const MemoryUsage& usage = reports[i].usage;
+		out << reports[i].name << " " << reports[i].containers << " " << usage.payload << " " << usage.overhead
+			<< " " << usage.slack << " " << usage.total() << std::endl;
+	}
+	if (names > 32) {
+		out << "(" << names - 32 << " smaller names not shown)" << std::endl;
+	}
+}
+
+#endif // !MEMORY_USAGE_H
@@ -0,0 +1,930 @@
+#ifndef RADIXTREE_H
+#define RADIXTREE_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "MemoryResource.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RADIX_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*adaptive radix tree (ART) - ordered map with the same insert/find/remove/scan surface as BPlusTree.
+* keys are turned into bytes (RadixKey below) and every inner node branches on one byte, so a lookup
+* costs O(key length) and never compares whole keys on the way down - only once, at the leaf.
+* inner nodes grow and shrink between 4, 16, 48 and 256 children to keep them small when sparse.
+* path compression: a chain of one-child nodes is folded into its child's prefix. only the first
+* RADIX_MAX_PREFIX bytes are stored, longer prefixes are skipped while searching and checked at the leaf.
+* a key that ends at an inner node (a prefix of other keys, like "/api" and "/api/users") is that node's terminal.
+* K must have a RadixKey specialization (integers and std::string have one)*/
+
+#define RADIX_MAX_PREFIX 12
+
+/*binary comparable bytes of a key - comparing them with memcmp (and the shorter key first on a tie)
+  orders keys like operator< does. integers are stored big endian with the sign bit flipped,
+  strings are used as they are. specialize it for other key types*/
+template<class K, class Enable = void>
+struct RadixKey;
+
+template<class K>
+struct RadixKey<K, typename std::enable_if<std::is_integral<K>::value>::type> {
+	uint8_t bytes[sizeof(K)];
+
+	explicit RadixKey(K key) {
+		typedef typename std::make_unsigned<K>::type U;
+		U bits = (U)key;
+		if (std::is_signed<K>::value) {
+			bits ^= (U)((U)1 << (sizeof(K) * 8 - 1)); //negatives first
+		}
+		for (int i = (int)sizeof(K) - 1; i >= 0; i--) {
+			bytes[i] = (uint8_t)bits;
+			bits = (U)(bits >> 8);
+		}
+	}
+	const uint8_t* data() const {
+		return bytes;
+	}
+	int length() const {
+		return (int)sizeof(K);
+	}
+};
+
+template<>
+struct RadixKey<std::string> {
+	const std::string& key;
+
+	explicit RadixKey(const std::string& _key) : key(_key) {}
+	const uint8_t* data() const {
+		return (const uint8_t*)key.data();
+	}
+	int length() const {
+		return (int)key.size();
+	}
+};
+
+/*index of the lowest set bit, mask must not be 0*/
+static inline int radixFirstBit(unsigned mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+template<class K, class V>
+class RadixTree {
+	enum NodeType : uint8_t {
+		LEAF,
+		NODE4,
+		NODE16,
+		NODE48,
+		NODE256
+	};
+
+	struct RNode {
+		uint8_t type;
+	};
+
+	struct Leaf : RNode {
+		K key;
+		V value;
+
+		template<class KK, class... Args>
+		Leaf(KK&& _key, Args&&... args) : key(std::forward<KK>(_key)), value(std::forward<Args>(args)...) {
+			this->type = LEAF;
+		}
+	};
+
+	struct Inner : RNode {
+		uint16_t count; //children, the terminal is not counted
+		uint32_t prefix_length; //compressed bytes between the parent's branch byte and this node's
+		uint8_t prefix[RADIX_MAX_PREFIX]; //the first ones of them
+		Leaf* terminal; //key that ends right after the prefix
+	};
+
+	/*Node4 and Node16 keep their bytes sorted, children[i] belongs to keys[i]*/
+	struct Node4 : Inner {
+		uint8_t keys[4];
+		RNode* children[4];
+	};
+
+	struct Node16 : Inner {
+		uint8_t keys[16];
+		RNode* children[16];
+	};
+
+	/*index[byte] is the child's slot + 1, 0 = no child*/
+	struct Node48 : Inner {
+		uint8_t index[256];
+		RNode* children[48];
+	};
+
+	struct Node256 : Inner {
+		RNode* children[256];
+	};
+
+	RNode* root;
+	int size;
+	std::pmr::memory_resource* resource; //all nodes are allocated from here
+
+	template<class KK, class... Args>
+	Leaf* createLeaf(KK&& key, Args&&... args) {
+		return createObject<Leaf>(resource, std::forward<KK>(key), std::forward<Args>(args)...);
+	}
+	template<class NodeT>
+	NodeT* createInner(NodeType type) { //value initialized, so every field starts at 0
+		NodeT* node = createObject<NodeT>(resource);
+		node->type = type;
+		return node;
+	}
+	void destroyNode(RNode* node);
+	void destroySubtree(RNode* node);
+	RNode* copySubtree(RNode* node);
+	static void copyHeader(Inner* dest, const Inner* src);
+	static RNode** findChild(Inner* inner, uint8_t byte);
+	template<class F>
+	static bool forChildren(Inner* inner, F& f); //f(byte, child) in byte order until it returns false
+	static Leaf* minLeaf(RNode* node);
+	static int compareKeys(const RadixKey<K>& a, const RadixKey<K>& b);
+	static int checkPrefix(Inner* inner, const RadixKey<K>& key, int depth);
+	int prefixMismatch(Inner* inner, const RadixKey<K>& key, int depth);
+	int prefixOrder(Inner* inner, const RadixKey<K>& from, int depth);
+	void addChild(RNode** ref, uint8_t byte, RNode* child);
+	void removeChild(RNode** ref, uint8_t byte);
+	void collapse(RNode** ref);
+	void attachLeaf(RNode** ref, Leaf* leaf, int depth);
+	template<class KK, class... Args>
+	V* insertAUX(KK&& key, Args&&... args);
+	template<class F>
+	bool scanAUX(RNode* node, const RadixKey<K>* from, int depth, int& remaining, F& visit);
+
+public:
+	explicit RadixTree(std::pmr::memory_resource* _resource = std::pmr::get_default_resource())
+		: root(nullptr), size(0), resource(_resource) {}
+	~RadixTree();
+	RadixTree(const RadixTree<K, V>& tree); //uses the default resource like the std::pmr containers
+	RadixTree(RadixTree<K, V>&& tree); //takes tree's nodes and resource
+	RadixTree<K, V>& operator=(const RadixTree<K, V>& tree);
+	RadixTree<K, V>& operator=(RadixTree<K, V>&& tree);
+	int getSize();
+	V* find(const K& key); //nullptr if not found
+	V* insert(const K& key, const V& value); //returns the existing value if the key is already in the tree
+	V* insert(K&& key, V&& value); //key and value are left untouched if the key is already in the tree
+	template<class... Args>
+	V* emplace(K key, Args&&... args); //constructs the value inside the new leaf
+	bool remove(const K& key);
+	template<class F>
+	int scan(const K& from, int max_count, F visit); //calls visit(key, value) in order starting at from
+	template<class F>
+	int forEach(F visit); //every key in order
+	void printInOrder();
+	void clear();
+};
+
+/*RADIX TREE FUNCTION IMPLEMENTATIONS*/
+template<class K, class V>
+void RadixTree<K, V>::destroyNode(RNode* node)
+{
+	switch (node->type) {
+	case LEAF: destroyObject(resource, static_cast<Leaf*>(node)); break;
+	case NODE4: destroyObject(resource, static_cast<Node4*>(node)); break;
+	case NODE16: destroyObject(resource, static_cast<Node16*>(node)); break;
+	case NODE48: destroyObject(resource, static_cast<Node48*>(node)); break;
+	default: destroyObject(resource, static_cast<Node256*>(node)); break;
+	}
+}
+
+/*recursion is bounded by the key length, not by the number of keys*/
+template<class K, class V>
+void RadixTree<K, V>::destroySubtree(RNode* node)
+{
+	if (node == nullptr) return;
+	if (node->type != LEAF) {
+		Inner* inner = static_cast<Inner*>(node);
+		auto destroyChild = [this](uint8_t, RNode* child) {
+			destroySubtree(child);
+			return true;
+		};
+		forChildren(inner, destroyChild);
+		if (inner->terminal != nullptr) destroyNode(inner->terminal);
+	}
+	destroyNode(node);
+}
+
+template<class K, class V>
+typename RadixTree<K, V>::RNode* RadixTree<K, V>::copySubtree(RNode* node)
+{
+	if (node->type == LEAF) {
+		return createLeaf(static_cast<Leaf*>(node)->key, static_cast<Leaf*>(node)->value);
+	}
+	Inner* copy;
+	switch (node->type) {
+	case NODE4: {
+		Node4* dest = createObject<Node4>(resource, *static_cast<Node4*>(node));
+		for (int i = 0; i < dest->count; i++) dest->children[i] = copySubtree(dest->children[i]);
+		copy = dest;
+		break;
+	}
+	case NODE16: {
+		Node16* dest = createObject<Node16>(resource, *static_cast<Node16*>(node));
+		for (int i = 0; i < dest->count; i++) dest->children[i] = copySubtree(dest->children[i]);
+		copy = dest;
+		break;
+	}
+	case NODE48: {
+		Node48* dest = createObject<Node48>(resource, *static_cast<Node48*>(node));
+		for (int i = 0; i < 48; i++) {
+			if (dest->children[i] != nullptr) dest->children[i] = copySubtree(dest->children[i]);
+		}
+		copy = dest;
+		break;
+	}
+	default: {
+		Node256* dest = createObject<Node256>(resource, *static_cast<Node256*>(node));
+		for (int i = 0; i < 256; i++) {
+			if (dest->children[i] != nullptr) dest->children[i] = copySubtree(dest->children[i]);
+		}
+		copy = dest;
+		break;
+	}
+	}
+	if (copy->terminal != nullptr) {
+		copy->terminal = createLeaf(copy->terminal->key, copy->terminal->value);
+	}
+	return copy;
+}
+
+template<class K, class V>
+RadixTree<K, V>::~RadixTree()
+{
+	destroySubtree(root);
+}
+
+template<class K, class V>
+void RadixTree<K, V>::clear()
+{
+	destroySubtree(root);
+	root = nullptr;
+	size = 0;
+}
+
+template<class K, class V>
+RadixTree<K, V>::RadixTree(const RadixTree<K, V>& tree)
+	: root(nullptr), size(tree.size), resource(std::pmr::get_default_resource())
+{
+	if (tree.root != nullptr) {
+		root = copySubtree(tree.root);
+	}
+}
+
+template<class K, class V>
+RadixTree<K, V>::RadixTree(RadixTree<K, V>&& tree) : root(tree.root), size(tree.size), resource(tree.resource)
+{
+	tree.root = nullptr;
+	tree.size = 0;
+}
+
+template<class K, class V>
+RadixTree<K, V>& RadixTree<K, V>::operator=(const RadixTree<K, V>& tree)
+{
+	if (this == &tree) {
+		return *this;
+	}
+	clear(); //nodes are copied into this tree's resource
+	if (tree.root != nullptr) {
+		root = copySubtree(tree.root);
+	}
+	size = tree.size;
+	return *this;
+}
+
+/*nodes can only be taken over from a tree of the same resource, otherwise they are copied like operator=*/
+template<class K, class V>
+RadixTree<K, V>& RadixTree<K, V>::operator=(RadixTree<K, V>&& tree)
+{
+	if (this == &tree) {
+		return *this;
+	}
+	if (resource != tree.resource) {
+		*this = tree;
+		tree.clear();
+		return *this;
+	}
+	clear();
+	root = tree.root;
+	size = tree.size;
+	tree.root = nullptr;
+	tree.size = 0;
+	return *this;
+}
+
+template<class K, class V>
+int RadixTree<K, V>::getSize()
+{
+	return size;
+}
+
+template<class K, class V>
+void RadixTree<K, V>::copyHeader(Inner* dest, const Inner* src)
+{
+	dest->count = src->count;
+	dest->prefix_length = src->prefix_length;
+	memcpy(dest->prefix, src->prefix, RADIX_MAX_PREFIX);
+	dest->terminal = src->terminal;
+}
+
+/*returns the slot that holds the child for byte, nullptr if there is none*/
+template<class K, class V>
+typename RadixTree<K, V>::RNode** RadixTree<K, V>::findChild(Inner* inner, uint8_t byte)
+{
+	switch (inner->type) {
+	case NODE4: {
+		Node4* node = static_cast<Node4*>(inner);
+		for (int i = 0; i < node->count; i++) {
+			if (node->keys[i] == byte) return &node->children[i];
+		}
+		return nullptr;
+	}
+	case NODE16: {
+		Node16* node = static_cast<Node16*>(inner);
+#ifdef RADIX_SSE2
+		//all 16 bytes compared at once, the mask drops the unused slots
+		__m128i match = _mm_cmpeq_epi8(_mm_set1_epi8((char)byte), _mm_loadu_si128((const __m128i*)node->keys));
+		unsigned mask = (unsigned)_mm_movemask_epi8(match) & ((1u << node->count) - 1);
+		return mask != 0 ? &node->children[radixFirstBit(mask)] : nullptr;
+#else
+		for (int i = 0; i < node->count; i++) {
+			if (node->keys[i] == byte) return &node->children[i];
+		}
+		return nullptr;
+#endif
+	}
+	case NODE48: {
+		Node48* node = static_cast<Node48*>(inner);
+		return node->index[byte] != 0 ? &node->children[node->index[byte] - 1] : nullptr;
+	}
+	default: {
+		Node256* node = static_cast<Node256*>(inner);
+		return node->children[byte] != nullptr ? &node->children[byte] : nullptr;
+	}
+	}
+}
+
+template<class K, class V>
+template<class F>
+bool RadixTree<K, V>::forChildren(Inner* inner, F& f)
+{
+	switch (inner->type) {
+	case NODE4: {
+		Node4* node = static_cast<Node4*>(inner);
+		for (int i = 0; i < node->count; i++) {
+			if (!f(node->keys[i], node->children[i])) return false;
+		}
+		return true;
+	}
+	case NODE16: {
+		Node16* node = static_cast<Node16*>(inner);
+		for (int i = 0; i < node->count; i++) {
+			if (!f(node->keys[i], node->children[i])) return false;
+		}
+		return true;
+	}
+	case NODE48: {
+		Node48* node = static_cast<Node48*>(inner);
+		for (int b = 0; b < 256; b++) {
+			if (node->index[b] != 0 && !f((uint8_t)b, node->children[node->index[b] - 1])) return false;
+		}
+		return true;
+	}
+	default: {
+		Node256* node = static_cast<Node256*>(inner);
+		for (int b = 0; b < 256; b++) {
+			if (node->children[b] != nullptr && !f((uint8_t)b, node->children[b])) return false;
+		}
+		return true;
+	}
+	}
+}
+
+/*smallest key under node - a terminal is a prefix of every other key below it, so it comes first*/
+template<class K, class V>
+typename RadixTree<K, V>::Leaf* RadixTree<K, V>::minLeaf(RNode* node)
+{
+	while (node->type != LEAF) {
+		Inner* inner = static_cast<Inner*>(node);
+		if (inner->terminal != nullptr) return inner->terminal;
+		RNode* first = nullptr;
+		auto takeFirst = [&first](uint8_t, RNode* child) {
+			first = child;
+			return false;
+		};
+		forChildren(inner, takeFirst);
+		node = first;
+	}
+	return static_cast<Leaf*>(node);
+}
+
+template<class K, class V>
+int RadixTree<K, V>::compareKeys(const RadixKey<K>& a, const RadixKey<K>& b)
+{
+	int common = a.length() < b.length() ? a.length() : b.length();
+	int order = common > 0 ? memcmp(a.data(), b.data(), common) : 0;
+	if (order != 0) return order;
+	return a.length() - b.length();
+}
+
+/*number of stored prefix bytes that match key at depth - optimistic, the bytes past RADIX_MAX_PREFIX are
+  left for the leaf to check*/
+template<class K, class V>
+int RadixTree<K, V>::checkPrefix(Inner* inner, const RadixKey<K>& key, int depth)
+{
+	int limit = (int)inner->prefix_length < RADIX_MAX_PREFIX ? (int)inner->prefix_length : RADIX_MAX_PREFIX;
+	if (limit > key.length() - depth) limit = key.length() - depth;
+	int i = 0;
+	while (i < limit && inner->prefix[i] == key.data()[depth + i]) i++;
+	return i;
+}
+
+/*where key first differs from the whole prefix (prefix_length if it doesnt) - the bytes that are not stored
+  are read from any leaf below, they all share the prefix*/
+template<class K, class V>
+int RadixTree<K, V>::prefixMismatch(Inner* inner, const RadixKey<K>& key, int depth)
+{
+	int limit = (int)inner->prefix_length;
+	if (limit > key.length() - depth) limit = key.length() - depth;
+	int stored = limit < RADIX_MAX_PREFIX ? limit : RADIX_MAX_PREFIX;
+	int i = 0;
+	while (i < stored && inner->prefix[i] == key.data()[depth + i]) i++;
+	if (i < stored || limit <= RADIX_MAX_PREFIX) return i;
+	RadixKey<K> full(minLeaf(inner)->key);
+	while (i < limit && full.data()[depth + i] == key.data()[depth + i]) i++;
+	return i;
+}
+
+/*orders the keys below inner against from: -1 all smaller, 1 all larger (from ends inside the prefix
+  counts as larger), 0 the prefix matches and the search goes on below*/
+template<class K, class V>
+int RadixTree<K, V>::prefixOrder(Inner* inner, const RadixKey<K>& from, int depth)
+{
+	int mismatch = prefixMismatch(inner, from, depth);
+	if (mismatch == (int)inner->prefix_length) return 0;
+	if (depth + mismatch == from.length()) return 1;
+	uint8_t byte;
+	if (mismatch < RADIX_MAX_PREFIX) {
+		byte = inner->prefix[mismatch];
+	}
+	else {
+		RadixKey<K> full(minLeaf(inner)->key);
+		byte = full.data()[depth + mismatch];
+	}
+	return byte < from.data()[depth + mismatch] ? -1 : 1;
+}
+
+/*ref is the slot that holds the node, a node that has to grow is replaced there*/
+template<class K, class V>
+void RadixTree<K, V>::addChild(RNode** ref, uint8_t byte, RNode* child)
+{
+	Inner* inner = static_cast<Inner*>(*ref);
+	switch (inner->type) {
+	case NODE4: {
+		Node4* node = static_cast<Node4*>(inner);
+		if (node->count == 4) {
+			Node16* grown = createInner<Node16>(NODE16);
+			copyHeader(grown, node);
+			memcpy(grown->keys, node->keys, 4);
+			memcpy(grown->children, node->children, 4 * sizeof(RNode*));
+			destroyObject(resource, node);
+			*ref = grown;
+			addChild(ref, byte, child);
+			return;
+		}
+		int pos = node->count;
+		for (; pos > 0 && node->keys[pos - 1] > byte; pos--) {
+			node->keys[pos] = node->keys[pos - 1];
+			node->children[pos] = node->children[pos - 1];
+		}
+		node->keys[pos] = byte;
+		node->children[pos] = child;
+		node->count++;
+		return;
+	}
+	case NODE16: {
+		Node16* node = static_cast<Node16*>(inner);
+		if (node->count == 16) {
+			Node48* grown = createInner<Node48>(NODE48);
+			copyHeader(grown, node);
+			for (int i = 0; i < 16; i++) {
+				grown->children[i] = node->children[i];
+				grown->index[node->keys[i]] = (uint8_t)(i + 1);
+			}
+			destroyObject(resource, node);
+			*ref = grown;
+			addChild(ref, byte, child);
+			return;
+		}
+		int pos = node->count;
+		for (; pos > 0 && node->keys[pos - 1] > byte; pos--) {
+			node->keys[pos] = node->keys[pos - 1];
+			node->children[pos] = node->children[pos - 1];
+		}
+		node->keys[pos] = byte;
+		node->children[pos] = child;
+		node->count++;
+		return;
+	}
+	case NODE48: {
+		Node48* node = static_cast<Node48*>(inner);
+		if (node->count == 48) {
+			Node256* grown = createInner<Node256>(NODE256);
+			copyHeader(grown, node);
+			for (int b = 0; b < 256; b++) {
+				if (node->index[b] != 0) grown->children[b] = node->children[node->index[b] - 1];
+			}
+			destroyObject(resource, node);
+			*ref = grown;
+			addChild(ref, byte, child);
+			return;
+		}
+		int slot = 0;
+		while (node->children[slot] != nullptr) slot++; //removed children leave holes
+		node->children[slot] = child;
+		node->index[byte] = (uint8_t)(slot + 1);
+		node->count++;
+		return;
+	}
+	default: {
+		Node256* node = static_cast<Node256*>(inner);
+		node->children[byte] = child;
+		node->count++;
+		return;
+	}
+	}
+}
+
+/*shrinks a node well below the size it grew at (so alternating insert/remove does not resize every time)*/
+template<class K, class V>
+void RadixTree<K, V>::removeChild(RNode** ref, uint8_t byte)
+{
+	Inner* inner = static_cast<Inner*>(*ref);
+	switch (inner->type) {
+	case NODE4: {
+		Node4* node = static_cast<Node4*>(inner);
+		int pos = 0;
+		while (node->keys[pos] != byte) pos++;
+		for (node->count--; pos < node->count; pos++) {
+			node->keys[pos] = node->keys[pos + 1];
+			node->children[pos] = node->children[pos + 1];
+		}
+		collapse(ref);
+		return;
+	}
+	case NODE16: {
+		Node16* node = static_cast<Node16*>(inner);
+		int pos = 0;
+		while (node->keys[pos] != byte) pos++;
+		for (node->count--; pos < node->count; pos++) {
+			node->keys[pos] = node->keys[pos + 1];
+			node->children[pos] = node->children[pos + 1];
+		}
+		if (node->count == 3) {
+			Node4* shrunk = createInner<Node4>(NODE4);
+			copyHeader(shrunk, node);
+			memcpy(shrunk->keys, node->keys, 3);
+			memcpy(shrunk->children, node->children, 3 * sizeof(RNode*));
+			destroyObject(resource, node);
+			*ref = shrunk;
+		}
+		return;
+	}
+	case NODE48: {
+		Node48* node = static_cast<Node48*>(inner);
+		node->children[node->index[byte] - 1] = nullptr;
+		node->index[byte] = 0;
+		node->count--;
+		if (node->count == 12) {
+			Node16* shrunk = createInner<Node16>(NODE16);
+			copyHeader(shrunk, node);
+			int n = 0;
+			for (int b = 0; b < 256; b++) {
+				if (node->index[b] != 0) {
+					shrunk->keys[n] = (uint8_t)b;
+					shrunk->children[n++] = node->children[node->index[b] - 1];
+				}
+			}
+			destroyObject(resource, node);
+			*ref = shrunk;
+		}
+		return;
+	}
+	default: {
+		Node256* node = static_cast<Node256*>(inner);
+		node->children[byte] = nullptr;
+		node->count--;
+		if (node->count == 37) {
+			Node48* shrunk = createInner<Node48>(NODE48);
+			copyHeader(shrunk, node);
+			int n = 0;
+			for (int b = 0; b < 256; b++) {
+				if (node->children[b] != nullptr) {
+					shrunk->children[n] = node->children[b];
+					shrunk->index[b] = (uint8_t)(++n);
+				}
+			}
+			destroyObject(resource, node);
+			*ref = shrunk;
+		}
+		return;
+	}
+	}
+}
+
+/*a Node4 left with one child and no terminal is folded into the child (its prefix + the branch byte go
+  in front of the child's prefix), one left with no children is replaced by its terminal*/
+template<class K, class V>
+void RadixTree<K, V>::collapse(RNode** ref)
+{
+	Node4* node = static_cast<Node4*>(*ref);
+	if (node->count == 0) {
+		*ref = node->terminal;
+		destroyObject(resource, node);
+		return;
+	}
+	if (node->count > 1 || node->terminal != nullptr) return;
+	RNode* child = node->children[0];
+	if (child->type != LEAF) { //a leaf needs no prefix, it holds its whole key
+		Inner* inner = static_cast<Inner*>(child);
+		uint8_t merged[RADIX_MAX_PREFIX];
+		int n = 0;
+		for (int i = 0; i < (int)node->prefix_length && n < RADIX_MAX_PREFIX; i++) merged[n++] = node->prefix[i];
+		if (n < RADIX_MAX_PREFIX) merged[n++] = node->keys[0];
+		for (int i = 0; i < (int)inner->prefix_length && n < RADIX_MAX_PREFIX; i++) merged[n++] = inner->prefix[i];
+		memcpy(inner->prefix, merged, n);
+		inner->prefix_length += node->prefix_length + 1;
+	}
+	*ref = child;
+	destroyObject(resource, node);
+}
+
+/*links leaf under the inner node in ref, depth is where the node's prefix ends*/
+template<class K, class V>
+void RadixTree<K, V>::attachLeaf(RNode** ref, Leaf* leaf, int depth)
+{
+	RadixKey<K> bytes(leaf->key);
+	if (depth == bytes.length()) {
+		static_cast<Inner*>(*ref)->terminal = leaf;
+	}
+	else {
+		addChild(ref, bytes.data()[depth], leaf);
+	}
+}
+
+template<class K, class V>
+V* RadixTree<K, V>::find(const K& key)
+{
+	RadixKey<K> bytes(key);
+	RNode* node = root;
+	int depth = 0;
+	while (node != nullptr) {
+		if (node->type == LEAF) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+			return compareKeys(RadixKey<K>(leaf->key), bytes) == 0 ? &leaf->value : nullptr;
+		}
+		Inner* inner = static_cast<Inner*>(node);
+		if (inner->prefix_length != 0) {
+			int stored = (int)inner->prefix_length < RADIX_MAX_PREFIX ? (int)inner->prefix_length : RADIX_MAX_PREFIX;
+			if (checkPrefix(inner, bytes, depth) != stored) return nullptr;
+			depth += inner->prefix_length;
+		}
+		if (depth >= bytes.length()) {
+			Leaf* leaf = depth == bytes.length() ? inner->terminal : nullptr;
+			return leaf != nullptr && compareKeys(RadixKey<K>(leaf->key), bytes) == 0 ? &leaf->value : nullptr;
+		}
+		RNode** child = findChild(inner, bytes.data()[depth]);
+		node = child != nullptr ? *child : nullptr;
+		depth++;
+	}
+	return nullptr;
+}
+
+template<class K, class V>
+V* RadixTree<K, V>::insert(const K& key, const V& value)
+{
+	return insertAUX(key, value);
+}
+
+template<class K, class V>
+V* RadixTree<K, V>::insert(K&& key, V&& value)
+{
+	return insertAUX(std::move(key), std::move(value));
+}
+
+template<class K, class V>
+template<class... Args>
+V* RadixTree<K, V>::emplace(K key, Args&&... args)
+{
+	return insertAUX(std::move(key), std::forward<Args>(args)...);
+}
+
+/*the leaf is created last, once it is known the key is new. key may be moved into it, so from then on
+  its bytes are read from the leaf (attachLeaf)*/
+template<class K, class V>
+template<class KK, class... Args>
+V* RadixTree<K, V>::insertAUX(KK&& key, Args&&... args)
+{
+	RadixKey<K> bytes(key);
+	RNode** ref = &root;
+	int depth = 0;
+	while (true) {
+		RNode* node = *ref;
+		if (node == nullptr) { //empty tree
+			Leaf* leaf = createLeaf(std::forward<KK>(key), std::forward<Args>(args)...);
+			*ref = leaf;
+			size++;
+			return &leaf->value;
+		}
+		if (node->type == LEAF) { //lazy expansion - a new node splits the two keys where they differ
+			Leaf* existing = static_cast<Leaf*>(node);
+			RadixKey<K> existing_bytes(existing->key);
+			if (compareKeys(existing_bytes, bytes) == 0) return &existing->value;
+			int limit = bytes.length() < existing_bytes.length() ? bytes.length() : existing_bytes.length();
+			int common = depth;
+			while (common < limit && bytes.data()[common] == existing_bytes.data()[common]) common++;
+			Node4* split = createInner<Node4>(NODE4);
+			split->prefix_length = (uint32_t)(common - depth);
+			memcpy(split->prefix, bytes.data() + depth,
+				common - depth < RADIX_MAX_PREFIX ? common - depth : RADIX_MAX_PREFIX);
+			*ref = split;
+			attachLeaf(ref, existing, common);
+			Leaf* leaf = createLeaf(std::forward<KK>(key), std::forward<Args>(args)...);
+			attachLeaf(ref, leaf, common);
+			size++;
+			return &leaf->value;
+		}
+		Inner* inner = static_cast<Inner*>(node);
+		if (inner->prefix_length != 0) {
+			int mismatch = prefixMismatch(inner, bytes, depth);
+			if (mismatch < (int)inner->prefix_length) { //a new node takes the common part of the prefix
+				Node4* split = createInner<Node4>(NODE4);
+				split->prefix_length = (uint32_t)mismatch;
+				memcpy(split->prefix, inner->prefix, mismatch < RADIX_MAX_PREFIX ? mismatch : RADIX_MAX_PREFIX);
+				int rest = (int)inner->prefix_length - mismatch - 1;
+				uint8_t branch;
+				if (inner->prefix_length <= RADIX_MAX_PREFIX) {
+					branch = inner->prefix[mismatch];
+					memmove(inner->prefix, inner->prefix + mismatch + 1, rest);
+				}
+				else { //the bytes after the stored ones come from a leaf
+					RadixKey<K> full(minLeaf(inner)->key);
+					branch = full.data()[depth + mismatch];
+					memcpy(inner->prefix, full.data() + depth + mismatch + 1, rest < RADIX_MAX_PREFIX ? rest : RADIX_MAX_PREFIX);
+				}
+				inner->prefix_length = (uint32_t)rest;
+				*ref = split;
+				addChild(ref, branch, inner);
+				Leaf* leaf = createLeaf(std::forward<KK>(key), std::forward<Args>(args)...);
+				attachLeaf(ref, leaf, depth + mismatch);
+				size++;
+				return &leaf->value;
+			}
+			depth += inner->prefix_length;
+		}
+		if (depth == bytes.length()) { //the whole path matched, so a terminal holds this very key
+			if (inner->terminal != nullptr) return &inner->terminal->value;
+			inner->terminal = createLeaf(std::forward<KK>(key), std::forward<Args>(args)...);
+			size++;
+			return &inner->terminal->value;
+		}
+		RNode** child = findChild(inner, bytes.data()[depth]);
+		if (child == nullptr) {
+			uint8_t byte = bytes.data()[depth];
+			Leaf* leaf = createLeaf(std::forward<KK>(key), std::forward<Args>(args)...);
+			addChild(ref, byte, leaf);
+			size++;
+			return &leaf->value;
+		}
+		ref = child;
+		depth++;
+	}
+}
+
+template<class K, class V>
+bool RadixTree<K, V>::remove(const K& key)
+{
+	RadixKey<K> bytes(key);
+	RNode** ref = &root;
+	RNode** parent_ref = nullptr; //slot of the node that holds ref, and the byte ref hangs from
+	uint8_t parent_byte = 0;
+	int depth = 0;
+	while (*ref != nullptr) {
+		RNode* node = *ref;
+		if (node->type == LEAF) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+			if (compareKeys(RadixKey<K>(leaf->key), bytes) != 0) return false;
+			if (parent_ref == nullptr) {
+				*ref = nullptr;
+			}
+			else {
+				removeChild(parent_ref, parent_byte);
+			}
+			destroyObject(resource, leaf);
+			size--;
+			return true;
+		}
+		Inner* inner = static_cast<Inner*>(node);
+		if (inner->prefix_length != 0) {
+			int stored = (int)inner->prefix_length < RADIX_MAX_PREFIX ? (int)inner->prefix_length : RADIX_MAX_PREFIX;
+			if (checkPrefix(inner, bytes, depth) != stored) return false;
+			depth += inner->prefix_length;
+		}
+		if (depth >= bytes.length()) {
+			Leaf* leaf = depth == bytes.length() ? inner->terminal : nullptr;
+			if (leaf == nullptr || compareKeys(RadixKey<K>(leaf->key), bytes) != 0) return false;
+			inner->terminal = nullptr;
+			destroyObject(resource, leaf);
+			size--;
+			if (inner->type == NODE4) {
+				collapse(ref);
+			}
+			return true;
+		}
+		RNode** child = findChild(inner, bytes.data()[depth]);
+		if (child == nullptr) return false;
+		parent_ref = ref;
+		parent_byte = bytes.data()[depth];
+		ref = child;
+		depth++;
+	}
+	return false;
+}
+
+/*in order walk, from == nullptr means everything below node is >= the start key. the recursion is
+  bounded by the key length. returns false once max_count keys were visited*/
+template<class K, class V>
+template<class F>
+bool RadixTree<K, V>::scanAUX(RNode* node, const RadixKey<K>* from, int depth, int& remaining, F& visit)
+{
+	if (node->type == LEAF) {
+		Leaf* leaf = static_cast<Leaf*>(node);
+		if (from != nullptr && compareKeys(RadixKey<K>(leaf->key), *from) < 0) return true;
+		visit((const K&)leaf->key, leaf->value);
+		return --remaining > 0;
+	}
+	Inner* inner = static_cast<Inner*>(node);
+	if (from != nullptr) {
+		int order = prefixOrder(inner, *from, depth);
+		if (order < 0) return true;
+		depth += inner->prefix_length;
+		if (order > 0 || depth == from->length()) from = nullptr;
+	}
+	if (from == nullptr) {
+		if (inner->terminal != nullptr && !scanAUX(inner->terminal, from, depth, remaining, visit)) return false;
+		auto scanChild = [this, &remaining, &visit](uint8_t, RNode* child) {
+			return scanAUX(child, (const RadixKey<K>*)nullptr, 0, remaining, visit);
+		};
+		return forChildren(inner, scanChild);
+	}
+	uint8_t start = from->data()[depth]; //the terminal is a proper prefix of from, so it is smaller
+	auto scanChild = [this, from, depth, start, &remaining, &visit](uint8_t byte, RNode* child) {
+		if (byte < start) return true;
+		return scanAUX(child, byte == start ? from : nullptr, depth + 1, remaining, visit);
+	};
+	return forChildren(inner, scanChild);
+}
+
+template<class K, class V>
+template<class F>
+int RadixTree<K, V>::scan(const K& from, int max_count, F visit)
+{
+	if (root == nullptr || max_count <= 0) return 0;
+	RadixKey<K> bytes(from);
+	int remaining = max_count;
+	scanAUX(root, &bytes, 0, remaining, visit);
+	return max_count - remaining;
+}
+
+template<class K, class V>
+template<class F>
+int RadixTree<K, V>::forEach(F visit)
+{
+	if (root == nullptr) return 0;
+	int remaining = size;
+	scanAUX(root, (const RadixKey<K>*)nullptr, 0, remaining, visit);
+	return size - remaining;
+}
+
+template<class K, class V>
+void RadixTree<K, V>::printInOrder()
+{
+	forEach([](const K& key, V&) { std::cout << key << " "; });
+}
+
+#endif // !RADIXTREE_H
@@ -0,0 +1,472 @@
+#ifndef RELAXED_AVLTREE_H
+#define RELAXED_AVLTREE_H
+
+#include <iostream>
+#include "AVLtree.h"
+
+#define RELAXED_DIRTY 1 //height not recomputed since a node was inserted below
+#define RELAXED_TOMBSTONE 2 //removed, the node stays linked until compact()
+#define RELAXED_BATCH 65536 //dirty nodes that trigger a rebalance, besides the depth bound. large batches share more of the path
+#define RELAXED_LOCAL 64 //rebuilds of up to this many nodes use a buffer on the stack
+
+/*relaxed balance AVLtree for write heavy phases - insert links the new node like a plain binary search tree
+* and only marks the nodes above it dirty (stopping at the first one that already is), remove only marks the node
+* as a tombstone. the balancing work is done later in batches:
+* rebalance: recomputes the heights of the dirty nodes bottom up and rotates where the balance factor is 2,
+*            a subtree that drifted further is rebuilt perfectly balanced. afterwards the tree is a valid AVL tree
+* compact: rebuilds the whole tree without its tombstones - no swapTwoNodes relinking, no rotations
+* lookups never wait for either: an insert that lands deeper than the AVL height bound + max_extra_depth
+* rebalances right away, so no key is ever deeper than that, and compact runs by itself once the tombstones
+* outnumber the live keys. call rebalance()/compact() when there is idle time (e.g. between write phases).
+* not synchronized, like AVLtree. between rebalances the nodes hold tombstones and stale heights, which
+* AVLtree's own members (none of them virtual) would take for live keys - so the tree inherits AVLtree
+* protected, never converts to an AVLtree& and only the members that are safe on it are public*/
+template<class K, class V, class S = NoTreeStats>
+class RelaxedAVLtree : protected AVLtree<K, V, S> {
+	typedef Tnode<K, V> Node;
+
+	int dirty; //nodes marked RELAXED_DIRTY
+	int tombstones;
+	int max_extra_depth;
+	int depth_bound; //AVL height bound of the current node count + max_extra_depth
+	long long bound_low; //depth_bound holds while bound_low <= node count < bound_high
+	long long bound_high;
+
+	template<class KK, class... Args>
+	Node* emplaceAUX(KK&& key, Args&&... args);
+	void markPath(Node* node); //marks node and its clean ancestors dirty
+	int getDepthBound();
+	void link(Node* subtree, Node* parent, Node* old); //puts subtree where old was
+	Node* rebuildSubtree(Node* subtree, bool drop_tombstones);
+	static Node* buildAUX(Node** nodes, int count, Node* parent);
+	static void countFlagsAUX(Node* node, int& dirty_nodes, int& tombstone_nodes);
+
+public:
+	explicit RelaxedAVLtree(int _max_extra_depth = 2, std::pmr::memory_resource* _resource = std::pmr::get_default_resource())
+		: AVLtree<K, V, S>(_resource), dirty(0), tombstones(0), max_extra_depth(_max_extra_depth), depth_bound(0), bound_low(1), bound_high(0) {}
+	RelaxedAVLtree(const RelaxedAVLtree<K, V, S>& tree) = default;
+	RelaxedAVLtree(RelaxedAVLtree<K, V, S>&& tree); //takes tree's nodes and resource
+	RelaxedAVLtree<K, V, S>& operator=(const RelaxedAVLtree<K, V, S>& tree) = default;
+	RelaxedAVLtree<K, V, S>& operator=(RelaxedAVLtree<K, V, S>&& tree);
+	using AVLtree<K, V, S>::getSize; //live keys
+	using AVLtree<K, V, S>::getResource;
+	using AVLtree<K, V, S>::getStats;
+	using AVLtree<K, V, S>::getStatsSnapshot;
+	Node* find(const K& key); //nullptr if not found or removed
+	Node* insert(const K& key, const V& value); //returns the existing node if the key is already in the tree
+	Node* insert(K&& key, V&& value);
+	template<class... Args>
+	Node* emplace(K key, Args&&... args);
+	bool remove(const K& key);
+	void rebalance(); //makes the tree a valid AVL tree again
+	int compact(); //drops the tombstones (and rebalances), returns how many
+	void copyFrom(const AVLtree<K, V, S>& tree, int threads = 1); //like AVLtree::copyFrom, the copy comes out rebalanced
+	void copyFrom(const RelaxedAVLtree<K, V, S>& tree, int threads = 1) { //only a member may see tree as an AVLtree
+		copyFrom(static_cast<const AVLtree<K, V, S>&>(tree), threads);
+	}
+	int getDirty() {
+		return dirty;
+	}
+	int getTombstones() {
+		return tombstones;
+	}
+	int getMaxDepth() { //deepest a lookup can go right now
+		return getDepthBound();
+	}
+	MemoryUsage memoryUsage() const { //tombstones are overhead until compact() frees them
+		MemoryUsage usage = AVLtree<K, V, S>::memoryUsage();
+		usage.overhead += sizeof(RelaxedAVLtree<K, V, S>) - sizeof(AVLtree<K, V, S>) + (size_t)tombstones * sizeof(Node);
+		usage.allocations += tombstones;
+		return usage;
+	}
+	void printInOrder(); //live keys only
+	bool save(const char* path); //compacts first
+	bool load(const char* path);
+	void clear(int threads = 1);
+	void clear(TreeReclaimer& reclaimer);
+};
+
+/*RELAXED AVL TREE FUNCTION IMPLEMENTATIONS*/
+template<class K, class V, class S>
+RelaxedAVLtree<K, V, S>::RelaxedAVLtree(RelaxedAVLtree<K, V, S>&& tree)
+	: AVLtree<K, V, S>(std::move(tree)), dirty(tree.dirty), tombstones(tree.tombstones),
+	max_extra_depth(tree.max_extra_depth), depth_bound(0), bound_low(1), bound_high(0)
+{
+	tree.dirty = 0;
+	tree.tombstones = 0;
+}
+
+template<class K, class V, class S>
+RelaxedAVLtree<K, V, S>& RelaxedAVLtree<K, V, S>::operator=(RelaxedAVLtree<K, V, S>&& tree)
+{
+	if (this == &tree) {
+		return *this;
+	}
+	AVLtree<K, V, S>::operator=(std::move(tree)); //copies when the resources differ
+	dirty = tree.dirty;
+	tombstones = tree.tombstones;
+	if (this->resource == tree.resource) {
+		tree.dirty = 0;
+		tree.tombstones = 0;
+	}
+	return *this;
+}
+
+template<class K, class V, class S>
+Tnode<K, V>* RelaxedAVLtree<K, V, S>::find(const K& key)
+{
+	Node* node = AVLtree<K, V, S>::find(key, this->root);
+	return node != nullptr && (node->flags & RELAXED_TOMBSTONE) == 0 ? node : nullptr;
+}
+
+template<class K, class V, class S>
+Tnode<K, V>* RelaxedAVLtree<K, V, S>::insert(const K& key, const V& value)
+{
+	return emplaceAUX(key, value);
+}
+
+template<class K, class V, class S>
+Tnode<K, V>* RelaxedAVLtree<K, V, S>::insert(K&& key, V&& value)
+{
+	return emplaceAUX(std::move(key), std::move(value));
+}
+
+template<class K, class V, class S>
+template<class... Args>
+Tnode<K, V>* RelaxedAVLtree<K, V, S>::emplace(K key, Args&&... args)
+{
+	return emplaceAUX(std::move(key), std::forward<Args>(args)...);
+}
+
+/*a tombstone with the same key is brought back with the new value instead of linking a second node*/
+template<class K, class V, class S>
+template<class KK, class... Args>
+Tnode<K, V>* RelaxedAVLtree<K, V, S>::emplaceAUX(KK&& key, Args&&... args)
+{
+	this->stats.operation(TreeCounter::INSERT_CALLS);
+	Node* current = this->root;
+	Node* parent = nullptr;
+	bool to_left = false;
+	int depth = 0;
+	while (current != nullptr) {
+		this->stats.count(TreeCounter::INSERT_COMPARISONS);
+		if (key == current->key) {
+			if (current->flags & RELAXED_TOMBSTONE) {
+				current->value = V(std::forward<Args>(args)...);
+				current->flags &= ~RELAXED_TOMBSTONE;
+				tombstones--;
+				this->size++;
+			}
+			return current;
+		}
+		this->stats.count(TreeCounter::INSERT_COMPARISONS);
+		to_left = key < current->key;
+		parent = current;
+		current = to_left ? current->left : current->right;
+		depth++;
+	}
+	Node* new_node = createObject<Node>(this->resource, std::in_place, std::forward<KK>(key), std::forward<Args>(args)...);
+	new_node->parent = parent;
+	if (parent == nullptr) {
+		this->root = new_node;
+	}
+	else if (to_left) {
+		parent->left = new_node;
+	}
+	else {
+		parent->right = new_node;
+	}
+	this->size++;
+	markPath(parent);
+	if (dirty >= RELAXED_BATCH || depth > getDepthBound()) {
+		rebalance();
+	}
+	return new_node;
+}
+
+/*the dirty nodes always form a connected part at the top of the tree, so the walk can stop at the first one*/
+template<class K, class V, class S>
+void RelaxedAVLtree<K, V, S>::markPath(Node* node)
+{
+	for (; node != nullptr && (node->flags & RELAXED_DIRTY) == 0; node = node->parent) {
+		node->flags |= RELAXED_DIRTY;
+		dirty++;
+	}
+}
+
+/*an AVL tree of height h has at least F(h) nodes (F(0) = 1, F(1) = 2, F(h) = F(h-1) + F(h-2) + 1),
+  so the tallest one with n nodes has the largest h with F(h) <= n - about 1.44 log2(n)*/
+template<class K, class V, class S>
+int RelaxedAVLtree<K, V, S>::getDepthBound()
+{
+	long long nodes = this->size + tombstones;
+	if (nodes < bound_low || nodes >= bound_high) {
+		long long previous = 1, current = 2;
+		int height = 0;
+		while (current <= nodes) {
+			long long next = current + previous + 1;
+			previous = current;
+			current = next;
+			height++;
+		}
+		depth_bound = height + max_extra_depth;
+		bound_low = nodes > 0 ? previous : 0;
+		bound_high = current;
+	}
+	return depth_bound;
+}
+
+template<class K, class V, class S>
+bool RelaxedAVLtree<K, V, S>::remove(const K& key)
+{
+	Node* node = find(key);
+	if (node == nullptr) {
+		return false;
+	}
+	node->flags |= RELAXED_TOMBSTONE;
+	this->size--;
+	tombstones++;
+	if (tombstones > this->size) {
+		compact();
+	}
+	return true;
+}
+
+template<class K, class V, class S>
+void RelaxedAVLtree<K, V, S>::link(Node* subtree, Node* parent, Node* old)
+{
+	if (subtree != nullptr) {
+		subtree->parent = parent;
+	}
+	if (parent == nullptr) {
+		this->root = subtree;
+	}
+	else if (parent->left == old) {
+		parent->left = subtree;
+	}
+	else {
+		parent->right = subtree;
+	}
+}
+
+/*balanced tree of nodes[0..count-1] (in key order), heights and augments set bottom up.
+  recursion depth is log2(count)*/
+template<class K, class V, class S>
+Tnode<K, V>* RelaxedAVLtree<K, V, S>::buildAUX(Node** nodes, int count, Node* parent)
+{
+	if (count == 0) {
+		return nullptr;
+	}
+	int middle = count / 2;
+	Node* node = nodes[middle];
+	node->parent = parent;
+	node->left = buildAUX(nodes, middle, node);
+	node->right = buildAUX(nodes + middle + 1, count - middle - 1, node);
+	node->flags &= ~RELAXED_DIRTY;
+	updateNodeHeight(node);
+	return node;
+}
+
+/*recursion depth is the tree height, which the depth bound keeps small*/
+template<class K, class V, class S>
+void RelaxedAVLtree<K, V, S>::countFlagsAUX(Node* node, int& dirty_nodes, int& tombstone_nodes)
+{
+	if (node == nullptr) {
+		return;
+	}
+	dirty_nodes += (node->flags & RELAXED_DIRTY) != 0;
+	tombstone_nodes += (node->flags & RELAXED_TOMBSTONE) != 0;
+	countFlagsAUX(node->left, dirty_nodes, tombstone_nodes);
+	countFlagsAUX(node->right, dirty_nodes, tombstone_nodes);
+}
+
+/*flattens the subtree in order (through the parent links, like printInOrder) and builds it again perfectly
+  balanced in its place. returns the new subtree root*/
+template<class K, class V, class S>
+Tnode<K, V>* RelaxedAVLtree<K, V, S>::rebuildSubtree(Node* subtree, bool drop_tombstones)
+{
+	Node* parent = subtree->parent;
+	int count = 0;
+	Node* current = subtree;
+	while (current->left != nullptr) current = current->left;
+	Node* first = current;
+	while (current != parent) {
+		count++;
+		if (current->right != nullptr) {
+			current = current->right;
+			while (current->left != nullptr) current = current->left;
+		}
+		else {
+			while (current->parent != parent && current == current->parent->right) current = current->parent;
+			current = current->parent;
+		}
+	}
+	Node* local[RELAXED_LOCAL];
+	Node** nodes = count <= RELAXED_LOCAL ? local : new Node*[count];
+	int live = 0;
+	int dropped = 0;
+	Node** dead = drop_tombstones ? new Node*[count] : nullptr;
+	current = first;
+	while (current != parent) {
+		if (drop_tombstones && (current->flags & RELAXED_TOMBSTONE)) {
+			dead[dropped++] = current;
+		}
+		else {
+			nodes[live++] = current;
+		}
+		if (current->flags & RELAXED_DIRTY) {
+			dirty--;
+		}
+		if (current->right != nullptr) {
+			current = current->right;
+			while (current->left != nullptr) current = current->left;
+		}
+		else {
+			while (current->parent != parent && current == current->parent->right) current = current->parent;
+			current = current->parent;
+		}
+	}
+	Node* rebuilt = buildAUX(nodes, live, parent);
+	link(rebuilt, parent, subtree);
+	for (int i = 0; i < dropped; i++) {
+		destroyObject(this->resource, dead[i]); //after the walk, it needed their links
+	}
+	tombstones -= dropped;
+	delete[] dead;
+	if (nodes != local) {
+		delete[] nodes;
+	}
+	return rebuilt;
+}
+
+/*the dirty nodes are fixed in post order (children before parents) during one walk from the root: a
+  node's children are valid AVL subtrees by the time it is reached, so a balance factor of 2 needs one
+  single or double rotation like in a plain insert. the walk climbs on from whatever node ends up in the
+  fixed node's slot, so rotations and rebuilds below do not disturb it*/
+template<class K, class V, class S>
+void RelaxedAVLtree<K, V, S>::rebalance()
+{
+	if (dirty == 0) {
+		return;
+	}
+	Node* current = this->root;
+	Node* came_from = nullptr;
+	while (true) { //the same walk as treeCopyAUX, restricted to the dirty nodes
+		if (came_from == nullptr && current->left != nullptr && (current->left->flags & RELAXED_DIRTY)) {
+			current = current->left;
+			continue;
+		}
+		if (came_from != current->right && current->right != nullptr && (current->right->flags & RELAXED_DIRTY)) {
+			current = current->right;
+			came_from = nullptr;
+			continue;
+		}
+		Node* parent = current->parent;
+		current->flags &= ~RELAXED_DIRTY;
+		this->stats.count(TreeCounter::PATH_NODES);
+		updateNodeHeight(current);
+		int balance = current->getBF();
+		if (balance == 2 || balance == -2) {
+			rotate(static_cast<AVLtree<K, V, S>*>(this), current);
+			if (this->root->parent != nullptr) {
+				this->root = this->root->parent;
+			}
+			current = current->parent; //the rotated up child took its place
+		}
+		else if (balance > 2 || balance < -2) { //its descendants are clean already, so the rebuild counts no dirty nodes
+			current = rebuildSubtree(current, false);
+		}
+		if (parent == nullptr) {
+			break;
+		}
+		came_from = current;
+		current = parent;
+	}
+	dirty = 0;
+}
+
+template<class K, class V, class S>
+int RelaxedAVLtree<K, V, S>::compact()
+{
+	int dropped = tombstones;
+	if (this->root != nullptr && (tombstones > 0 || dirty > 0)) {
+		rebuildSubtree(this->root, true);
+	}
+	dirty = 0;
+	return dropped;
+}
+
+template<class K, class V, class S>
+void RelaxedAVLtree<K, V, S>::printInOrder()
+{
+	Node* current = this->root;
+	if (current == nullptr) return;
+	while (current->left != nullptr) current = current->left;
+	while (current != nullptr) {
+		if ((current->flags & RELAXED_TOMBSTONE) == 0) {
+			std::cout << current->key << " ";
+		}
+		if (current->right != nullptr) {
+			current = current->right;
+			while (current->left != nullptr) current = current->left;
+		}
+		else {
+			while (current->parent != nullptr && current == current->parent->right) current = current->parent;
+			current = current->parent;
+		}
+	}
+}
+
+template<class K, class V, class S>
+bool RelaxedAVLtree<K, V, S>::save(const char* path)
+{
+	compact();
+	return AVLtree<K, V, S>::save(path);
+}
+
+template<class K, class V, class S>
+bool RelaxedAVLtree<K, V, S>::load(const char* path)
+{
+	if (!AVLtree<K, V, S>::load(path)) {
+		return false;
+	}
+	dirty = 0;
+	tombstones = 0;
+	return true;
+}
+
+template<class K, class V, class S>
+void RelaxedAVLtree<K, V, S>::clear(int threads)
+{
+	AVLtree<K, V, S>::clear(threads);
+	dirty = 0;
+	tombstones = 0;
+}
+
+template<class K, class V, class S>
+void RelaxedAVLtree<K, V, S>::clear(TreeReclaimer& reclaimer)
+{
+	AVLtree<K, V, S>::clear(reclaimer);
+	dirty = 0;
+	tombstones = 0;
+}
+
+/*the nodes keep their flags, so the dirty nodes and tombstones of tree (a relaxed tree or a plain one) are
+  counted again. the copy is rebalanced right away - tree may allow deeper nodes than this tree's bound*/
+template<class K, class V, class S>
+void RelaxedAVLtree<K, V, S>::copyFrom(const AVLtree<K, V, S>& tree, int threads)
+{
+	if (this == &tree) {
+		return;
+	}
+	AVLtree<K, V, S>::copyFrom(tree, threads);
+	dirty = 0;
+	tombstones = 0;
+	countFlagsAUX(this->root, dirty, tombstones);
+	depth_bound = 0;
+	bound_low = 1;
+	bound_high = 0;
+	rebalance();
+}
+
+#endif // !RELAXED_AVLTREE_H
@@ -0,0 +1,189 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*binary snapshot format shared by AVLtree::save/load and HashTable::save/load
+* the file is a SnapshotHeader followed by the container's arrays. links between records are
+* indices into those arrays (never pointers), so a file can be mapped at any address and
+* used read-only right away. only trivially copyable keys/values/elements can be saved*/
+
+#define SNAPSHOT_MAGIC 0x504E5344u //"DSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ENDIAN 0x01020304u //read back swapped on a machine with the other byte order
+
+enum class SnapshotType {
+	AVL_TREE = 1,
+	HASH_TABLE = 2
+};
+
+struct SnapshotHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t type;
+	uint32_t endian;
+	uint32_t key_size; //sizeof(K), or sizeof(T) for a hash table
+	uint32_t value_size; //sizeof(V), 0 for a hash table
+	uint32_t reserved;
+	uint64_t count; //number of records
+	uint64_t buckets; //hash table size, 0 for a tree
+};
+
+/*fills a header for a new snapshot*/
+static inline SnapshotHeader makeSnapshotHeader(SnapshotType type, size_t key_size, size_t value_size,
+	uint64_t count, uint64_t buckets) {
+	SnapshotHeader header;
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.type = (uint16_t)type;
+	header.endian = SNAPSHOT_ENDIAN;
+	header.key_size = (uint32_t)key_size;
+	header.value_size = (uint32_t)value_size;
+	header.reserved = 0;
+	header.count = count;
+	header.buckets = buckets;
+	return header;
+}
+
+/********************************** MAPPED FILE IMPLEMENTATION **********************************/
+/*read only memory mapping of a whole file. pages are shared between all processes mapping it*/
+class MappedFile {
+	const char* data;
+	size_t length;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+
+public:
+	MappedFile() : data(nullptr), length(0) {}
+	~MappedFile() {
+		close();
+	}
+	MappedFile(const MappedFile& file) = delete;
+	MappedFile& operator=(const MappedFile& file) = delete;
+
+	bool open(const char* path);
+	void close();
+	const char* getData() const {
+		return data;
+	}
+	size_t getLength() const {
+		return length;
+	}
+	/*returns the header if the file holds a snapshot of the given type and record sizes, else nullptr*/
+	const SnapshotHeader* checkHeader(SnapshotType type, size_t key_size, size_t value_size) const;
+};
+
+/*returns false if the file cant be opened or mapped*/
+inline bool MappedFile::open(const char* path)
+{
+	close();
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	length = (size_t)file_size.QuadPart;
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); //the mapping keeps the file alive
+	if (mapped == MAP_FAILED) return false;
+	data = (const char*)mapped;
+	length = (size_t)st.st_size;
+#endif
+	return true;
+}
+
+inline void MappedFile::close()
+{
+	if (data == nullptr) return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	CloseHandle(file);
+#else
+	munmap((void*)data, length);
+#endif
+	data = nullptr;
+	length = 0;
+}
+
+inline const SnapshotHeader* MappedFile::checkHeader(SnapshotType type, size_t key_size, size_t value_size) const
+{
+	if (data == nullptr || length < sizeof(SnapshotHeader)) return nullptr;
+	const SnapshotHeader* header = (const SnapshotHeader*)data;
+	if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+		header->endian != SNAPSHOT_ENDIAN || header->type != (uint16_t)type ||
+		header->key_size != key_size || header->value_size != value_size) {
+		return nullptr;
+	}
+	return header;
+}
+
+/*takes records * record_size bytes out of the remaining file length, false if they dont fit. overflow
+  safe, the counts come from the file*/
+static inline bool takeSnapshotRecords(size_t& remaining, uint64_t records, size_t record_size) {
+	if (records > remaining / record_size) return false;
+	remaining -= (size_t)records * record_size;
+	return true;
+}
+
+/*hash table bucket offsets must start at 0, never decrease and end at count - anything else would
+  send a load past the elements array*/
+static inline bool checkSnapshotOffsets(const uint64_t* offsets, uint64_t buckets, uint64_t count) {
+	if (offsets[0] != 0 || offsets[buckets] != count) return false;
+	for (uint64_t i = 0; i < buckets; i++) {
+		if (offsets[i] > offsets[i + 1]) return false;
+	}
+	return true;
+}
+
+/*writes the header and then each (buffer, bytes) pair, returns false on any io error*/
+static inline bool writeSnapshot(const char* path, const SnapshotHeader& header,
+	const void* first, size_t first_bytes, const void* second, size_t second_bytes) {
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr) return false;
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	if (ok && first_bytes > 0) {
+		ok = fwrite(first, 1, first_bytes, file) == first_bytes;
+	}
+	if (ok && second_bytes > 0) {
+		ok = fwrite(second, 1, second_bytes, file) == second_bytes;
+	}
+	if (fclose(file) != 0) ok = false;
+	return ok;
+}
+
+#endif // !SNAPSHOT_H
@@ -0,0 +1,89 @@
+#ifndef STATIC_VECTOR_H
+#define STATIC_VECTOR_H
+
+#include <initializer_list>
+
+/*fixed capacity array with inline storage - no heap and no resource, so it can live on the stack
+  or in a constexpr table. unlike Vector it stores the elements themselves (not pointers to them).
+  every function is constexpr, which makes the whole vector usable at compile time when T is a literal
+  type. out of range adds fail with false instead of growing*/
+template <class T, int Cap>
+class StaticVector {
+    static_assert(Cap > 0, "StaticVector needs a positive capacity");
+
+    T arr[Cap];
+    int count; //one past the highest index added
+
+public:
+    constexpr StaticVector() : arr{}, count(0) {} //braces, gcc does not treat arr() as constant for aggregates
+    constexpr StaticVector(std::initializer_list<T> elms) : arr{}, count(0) { //elements past Cap are dropped
+        for (const T& elm : elms) {
+            pushBack(elm);
+        }
+    }
+
+    constexpr bool add(int idx, const T& elm); //like Vector::add, false if idx is out of [0, Cap)
+    constexpr bool pushBack(const T& elm); //false if full
+    constexpr int find(const T& elm) const; //index of the first equal element, -1 if none
+    constexpr T& operator[](int i) {
+        return arr[i];
+    }
+    constexpr const T& operator[](int i) const {
+        return arr[i];
+    }
+    constexpr T* begin() {
+        return arr;
+    }
+    constexpr T* end() {
+        return arr + count;
+    }
+    constexpr const T* begin() const {
+        return arr;
+    }
+    constexpr const T* end() const {
+        return arr + count;
+    }
+    constexpr int getCount() const {
+        return count;
+    }
+    static constexpr int getSize() { //capacity, like Vector::getSize
+        return Cap;
+    }
+    constexpr bool isFull() const {
+        return count == Cap;
+    }
+    constexpr void clear() {
+        count = 0;
+    }
+};
+
+/***********************FUNCTION IMPLEMENTATIONS*******************/
+/*slots skipped over keep whatever they held (value initialized at construction)*/
+template <class T, int Cap>
+constexpr bool StaticVector<T, Cap>::add(int idx, const T& elm) {
+    if (idx < 0 || idx >= Cap) {
+        return false;
+    }
+    arr[idx] = elm;
+    if (idx >= count) {
+        count = idx + 1;
+    }
+    return true;
+}
+
+template <class T, int Cap>
+constexpr bool StaticVector<T, Cap>::pushBack(const T& elm) {
+    return add(count, elm);
+}
+
+template <class T, int Cap>
+constexpr int StaticVector<T, Cap>::find(const T& elm) const {
+    for (int i = 0; i < count; i++) {
+        if (arr[i] == elm) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#endif //STATIC_VECTOR_H
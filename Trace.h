@@ -0,0 +1,306 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include "Snapshot.h"
+#include "AVLtree.h"
+#include "HashTable/hashTable.h" //brings HashTable/list.h and vector.h
+
+/*operation traces - the Traced* wrappers forward every call to a container and append (op, key, time)
+* to a TraceWriter. the file is a TraceHeader followed by fixed size TraceRecords, so a TraceReader
+* maps it and replays it in place (benchmark --replay runs a trace against every comparable container).
+* a trace should be started on an empty container, otherwise the replay starts from a different state.
+* a writer is not thread safe - give every thread its own writer and file*/
+
+#define TRACE_MAGIC 0x43525444u //"DTRC"
+#define TRACE_VERSION 1
+#define TRACE_BUFFER 1024 //records written per fwrite
+
+enum class TraceSource {
+	AVL_TREE = 1,
+	HASH_TABLE = 2,
+	LIST = 3,
+	VECTOR = 4
+};
+
+enum class TraceOp {
+	INSERT = 1, //key, or the index for a vector
+	FIND = 2,
+	REMOVE = 3,
+	PUSH_FRONT = 4,
+	PUSH_BACK = 5,
+	POP_FRONT = 6, //key of the popped element
+	GET = 7 //vector index
+};
+
+struct TraceHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t source;
+	uint32_t endian; //SNAPSHOT_ENDIAN
+	uint32_t record_size;
+	uint64_t count; //number of records
+	uint64_t duration_ns; //first to last record
+};
+
+/*16 bytes - time is the gap since the previous record (saturates at ~4.3s) so it fits in 32 bits*/
+struct TraceRecord {
+	int64_t key;
+	uint32_t delta_ns;
+	uint8_t op;
+	uint8_t reserved[3];
+};
+
+/*converts a container key to the int64 stored in a record. specialize it for keys that are not integers*/
+template<class K>
+struct TraceKey {
+	static int64_t of(const K& key) {
+		return (int64_t)key;
+	}
+};
+
+/********************************** WRITER **********************************/
+class TraceWriter {
+	typedef std::chrono::steady_clock Clock;
+
+	FILE* file;
+	TraceHeader header;
+	TraceRecord buffer[TRACE_BUFFER];
+	int buffered;
+	Clock::time_point start;
+	Clock::time_point last;
+
+	bool flush();
+
+public:
+	TraceWriter() : file(nullptr), buffered(0) {}
+	~TraceWriter() {
+		close();
+	}
+	TraceWriter(const TraceWriter& writer) = delete;
+	TraceWriter& operator=(const TraceWriter& writer) = delete;
+
+	bool open(const char* path, TraceSource source); //truncates path
+	void record(TraceOp op, int64_t key);
+	bool close(); //writes the final header, returns false if any write failed
+	uint64_t getCount() const {
+		return header.count + (uint64_t)buffered;
+	}
+	bool isOpen() const {
+		return file != nullptr;
+	}
+};
+
+inline bool TraceWriter::open(const char* path, TraceSource source)
+{
+	close();
+	file = fopen(path, "wb");
+	if (file == nullptr) return false;
+	header.magic = TRACE_MAGIC;
+	header.version = TRACE_VERSION;
+	header.source = (uint16_t)source;
+	header.endian = SNAPSHOT_ENDIAN;
+	header.record_size = sizeof(TraceRecord);
+	header.count = 0;
+	header.duration_ns = 0;
+	buffered = 0;
+	if (fwrite(&header, sizeof(header), 1, file) != 1) { //rewritten by close
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+	start = last = Clock::now();
+	return true;
+}
+
+inline void TraceWriter::record(TraceOp op, int64_t key)
+{
+	if (file == nullptr) return;
+	Clock::time_point now = Clock::now();
+	int64_t delta = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+	last = now;
+	TraceRecord& record = buffer[buffered++];
+	record.key = key;
+	record.delta_ns = delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta;
+	record.op = (uint8_t)op;
+	record.reserved[0] = record.reserved[1] = record.reserved[2] = 0;
+	if (buffered == TRACE_BUFFER) flush();
+}
+
+inline bool TraceWriter::flush()
+{
+	bool ok = buffered == 0 || fwrite(buffer, sizeof(TraceRecord), buffered, file) == (size_t)buffered;
+	header.count += ok ? (uint64_t)buffered : 0;
+	buffered = 0;
+	return ok;
+}
+
+inline bool TraceWriter::close()
+{
+	if (file == nullptr) return true;
+	bool ok = flush();
+	header.duration_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(last - start).count();
+	ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1 && ok;
+	ok = fclose(file) == 0 && ok;
+	file = nullptr;
+	return ok;
+}
+
+/********************************** READER **********************************/
+/*maps a trace read only, the records are used straight from the mapping*/
+class TraceReader {
+	MappedFile file;
+	const TraceHeader* header;
+	const TraceRecord* records;
+
+public:
+	TraceReader() : header(nullptr), records(nullptr) {}
+	bool open(const char* path); //false if the file is missing, truncated or not a trace of this machine's byte order
+	TraceSource getSource() const {
+		return (TraceSource)header->source;
+	}
+	uint64_t getCount() const {
+		return header->count;
+	}
+	uint64_t getDurationNs() const {
+		return header->duration_ns;
+	}
+	const TraceRecord& operator[](uint64_t i) const {
+		return records[i];
+	}
+};
+
+inline bool TraceReader::open(const char* path)
+{
+	header = nullptr;
+	records = nullptr;
+	if (!file.open(path)) return false;
+	const TraceHeader* candidate = (const TraceHeader*)file.getData();
+	if (file.getLength() < sizeof(TraceHeader) || candidate->magic != TRACE_MAGIC ||
+		candidate->version != TRACE_VERSION || candidate->endian != SNAPSHOT_ENDIAN ||
+		candidate->record_size != sizeof(TraceRecord) ||
+		candidate->count > (file.getLength() - sizeof(TraceHeader)) / sizeof(TraceRecord)) {
+		file.close();
+		return false;
+	}
+	header = candidate;
+	records = (const TraceRecord*)(file.getData() + sizeof(TraceHeader));
+	return true;
+}
+
+/********************************** TRACED CONTAINERS **********************************/
+/*the wrappers only forward, the container stays usable (and untraced) through get()*/
+template<class K, class V, class S = NoTreeStats>
+class TracedAVLtree {
+	AVLtree<K, V, S>& tree;
+	TraceWriter& trace;
+
+public:
+	TracedAVLtree(AVLtree<K, V, S>& _tree, TraceWriter& _trace) : tree(_tree), trace(_trace) {}
+	Tnode<K, V>* insert(const K& key, const V& value) {
+		trace.record(TraceOp::INSERT, TraceKey<K>::of(key));
+		return tree.insert(key, value);
+	}
+	Tnode<K, V>* insert(K&& key, V&& value) {
+		trace.record(TraceOp::INSERT, TraceKey<K>::of(key));
+		return tree.insert(std::move(key), std::move(value));
+	}
+	Tnode<K, V>* find(const K& key) {
+		trace.record(TraceOp::FIND, TraceKey<K>::of(key));
+		return tree.find(key, tree.getRoot());
+	}
+	bool remove(const K& key) {
+		trace.record(TraceOp::REMOVE, TraceKey<K>::of(key));
+		return tree.remove(key, tree.getRoot());
+	}
+	AVLtree<K, V, S>& get() {
+		return tree;
+	}
+};
+
+template<class T>
+class TracedHashTable {
+	HashTable<T>& table;
+	TraceWriter& trace;
+
+public:
+	TracedHashTable(HashTable<T>& _table, TraceWriter& _trace) : table(_table), trace(_trace) {}
+	Node<T>* insert(T* element, int key) {
+		trace.record(TraceOp::INSERT, key);
+		return table.insert(element, key);
+	}
+	Node<T>* insert(T&& element, int key) {
+		trace.record(TraceOp::INSERT, key);
+		return table.insert(std::move(element), key);
+	}
+	Node<T>* find(const T& element, int key) {
+		trace.record(TraceOp::FIND, key);
+		return table.find(element, key);
+	}
+	void remove(const T& element, int key) {
+		trace.record(TraceOp::REMOVE, key);
+		table.remove(element, key);
+	}
+	HashTable<T>& get() {
+		return table;
+	}
+};
+
+/*list keys are the elements themselves (through TraceKey<D>), remove records the key of the removed node*/
+template<class D>
+class TracedList {
+	List<D>& list;
+	TraceWriter& trace;
+
+public:
+	TracedList(List<D>& _list, TraceWriter& _trace) : list(_list), trace(_trace) {}
+	void pushFront(const D& data) {
+		trace.record(TraceOp::PUSH_FRONT, TraceKey<D>::of(data));
+		list.insestAfterNode(data, list.getHead());
+	}
+	void pushBack(const D& data) {
+		trace.record(TraceOp::PUSH_BACK, TraceKey<D>::of(data));
+		list.insertBeforeNode(data, list.getTail());
+	}
+	Node<D>* popFront() { //pops without deleting, the list must not be empty (like List::pop_front)
+		Node<D>* node = list.pop_front();
+		trace.record(TraceOp::POP_FRONT, TraceKey<D>::of(node->data));
+		return node;
+	}
+	Node<D>* find(const D& data) {
+		trace.record(TraceOp::FIND, TraceKey<D>::of(data));
+		return list.find(data);
+	}
+	Node<D>* remove(Node<D>* node) {
+		trace.record(TraceOp::REMOVE, TraceKey<D>::of(node->data));
+		return list.remove(node);
+	}
+	List<D>& get() {
+		return list;
+	}
+};
+
+/*vector records carry the index, the stored pointers are not traced*/
+template<class T>
+class TracedVector {
+	Vector<T>& vector;
+	TraceWriter& trace;
+
+public:
+	TracedVector(Vector<T>& _vector, TraceWriter& _trace) : vector(_vector), trace(_trace) {}
+	void add(int idx, T* elm) {
+		trace.record(TraceOp::INSERT, idx);
+		vector.add(idx, elm);
+	}
+	T& operator[](int i) {
+		trace.record(TraceOp::GET, i);
+		return vector[i];
+	}
+	Vector<T>& get() {
+		return vector;
+	}
+};
+
+#endif // !TRACE_H
@@ -0,0 +1,1229 @@
+/*benchmark suite - runs every container against its STL baseline and prints one JSON document
+* usage: benchmark [--min-size N] [--max-size N] [--filter text] [--timeout seconds]
+*  sizes go from min to max (x8 each step) so the working set goes from L1 to well past the LLC
+*  every (container, scenario, size) case runs in its own process so peak RSS belongs to that case only,
+*  a case that runs longer than the timeout is killed and reported on stderr
+*  latency is sampled (at most MAX_SAMPLES timed ops per case) and reported as p50/p99 in ns
+* usage: benchmark --replay trace [--filter text]
+*  replays a trace recorded with Trace.h against every container that supports its operations*/
+
+#include "../HashTable/hashTable.h" //brings HashTable/list.h, which has the List used below
+#include "../HashTable/rcuHashTable.h"
+#include "../HashTable/cuckooHashTable.h"
+#include "../HashTable/expiringHashTable.h"
+#include "../AVLtree.h"
+#include "../RelaxedAVLtree.h"
+#include "../BPlusTree.h"
+#include "../RadixTree.h"
+#include "../List.h"
+#include "../vector.h"
+#include "../ConcurrentQueue.h"
+#include "../Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define MAX_SAMPLES 100000
+#define SCAN_LENGTH 100
+#define PROBE_BATCH 256 //keys per findMany call in batch_lookup
+#define WRITE_PAUSE_US 100 //gap between the writer's updates in read_mostly
+#define LIST_FIND_BUDGET (1 << 26) //max node visits for the O(n) list lookups
+
+typedef std::chrono::steady_clock Clock;
+
+/********************************** MEASUREMENT **********************************/
+struct Result {
+	std::string container;
+	std::string scenario;
+	long size;
+	long ops;
+	int threads;
+	double seconds;
+	double p50_ns;
+	double p99_ns;
+	long peak_rss_kb;
+};
+
+/*times a whole run, and every stride-th op individually for the latency percentiles*/
+class Recorder {
+	std::vector<double> samples;
+	long stride;
+	long ops;
+	Clock::time_point start;
+	double seconds;
+
+public:
+	explicit Recorder(long expected_ops) : stride(expected_ops / MAX_SAMPLES + 1), ops(0), seconds(0) {
+		samples.reserve(MAX_SAMPLES + 1);
+	}
+
+	void begin() {
+		start = Clock::now();
+	}
+
+	void end() {
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	template<class F>
+	void op(F f) {
+		if (ops++ % stride != 0) {
+			f();
+			return;
+		}
+		Clock::time_point before = Clock::now();
+		f();
+		samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+	}
+
+	void fill(Result& result) {
+		result.ops = ops;
+		result.seconds = seconds;
+		result.p50_ns = percentile(0.50);
+		result.p99_ns = percentile(0.99);
+	}
+
+	double percentile(double p) {
+		if (samples.empty()) return 0;
+		size_t index = (size_t)(p * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index];
+	}
+};
+
+static long peakRssKb() {
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss; //KB on linux
+#else
+	return 0;
+#endif
+}
+
+static volatile long sink; //keeps lookups from being optimized away
+static unsigned case_timeout = 120; //seconds
+
+/*keys are even so that odd keys are guaranteed misses*/
+static std::vector<int> makeKeys(long n, bool shuffled) {
+	std::vector<int> keys(n);
+	for (long i = 0; i < n; i++) {
+		keys[i] = (int)(2 * i + 2);
+	}
+	if (shuffled) {
+		std::mt19937 rng(42);
+		std::shuffle(keys.begin(), keys.end(), rng);
+	}
+	return keys;
+}
+
+/********************************** ADAPTORS **********************************/
+/*every adaptor exposes the same small interface so the scenarios can be written once*/
+class AvlAdaptor {
+	AVLtree<int, int> tree;
+
+	static Tnode<int, int>* lowerBound(Tnode<int, int>* node, int key) {
+		Tnode<int, int>* best = nullptr;
+		while (node != nullptr) {
+			if (node->key >= key) {
+				best = node;
+				node = node->left;
+			}
+			else {
+				node = node->right;
+			}
+		}
+		return best;
+	}
+
+	static Tnode<int, int>* successor(Tnode<int, int>* node) {
+		if (node->right != nullptr) {
+			node = node->right;
+			while (node->left != nullptr) node = node->left;
+			return node;
+		}
+		while (node->parent != nullptr && node == node->parent->right) node = node->parent;
+		return node->parent;
+	}
+
+public:
+	static const char* name() { return "AVLtree"; }
+	void insert(int key) { tree.insert(key, key); }
+	bool find(int key) { return tree.find(key, tree.getRoot()) != nullptr; }
+	void remove(int key) { tree.remove(key, tree.getRoot()); }
+	long scan(int from, int length) {
+		long sum = 0;
+		Tnode<int, int>* node = lowerBound(tree.getRoot(), from);
+		for (int i = 0; i < length && node != nullptr; i++, node = successor(node)) sum += node->value;
+		return sum;
+	}
+};
+
+/*relaxed balance - the rebalancing left after a scenario is not part of its time*/
+class RelaxedAvlAdaptor {
+	RelaxedAVLtree<int, int> tree;
+
+public:
+	static const char* name() { return "RelaxedAVLtree"; }
+	void insert(int key) { tree.insert(key, key); }
+	bool find(int key) { return tree.find(key) != nullptr; }
+	void remove(int key) { tree.remove(key); }
+};
+
+class BPlusTreeAdaptor {
+	BPlusTree<int, int> tree;
+
+public:
+	static const char* name() { return "BPlusTree"; }
+	void insert(int key) { tree.insert(key, key); }
+	bool find(int key) { return tree.find(key) != nullptr; }
+	void remove(int key) { tree.remove(key); }
+	long scan(int from, int length) {
+		long sum = 0;
+		tree.scan(from, length, [&sum](const int&, int& value) { sum += value; });
+		return sum;
+	}
+};
+
+class RadixTreeAdaptor {
+	RadixTree<int, int> tree;
+
+public:
+	static const char* name() { return "RadixTree"; }
+	void insert(int key) { tree.insert(key, key); }
+	bool find(int key) { return tree.find(key) != nullptr; }
+	void remove(int key) { tree.remove(key); }
+	long scan(int from, int length) {
+		long sum = 0;
+		tree.scan(from, length, [&sum](const int&, int& value) { sum += value; });
+		return sum;
+	}
+};
+
+class MapAdaptor {
+	std::map<int, int> map;
+
+public:
+	static const char* name() { return "std::map"; }
+	void insert(int key) { map.emplace(key, key); }
+	bool find(int key) { return map.find(key) != map.end(); }
+	void remove(int key) { map.erase(key); }
+	long scan(int from, int length) {
+		long sum = 0;
+		std::map<int, int>::iterator it = map.lower_bound(from);
+		for (int i = 0; i < length && it != map.end(); i++, ++it) sum += it->second;
+		return sum;
+	}
+};
+
+/*HashTable elements must return their key from operator()*/
+struct BenchElement {
+	int key;
+	int value;
+	int operator()() const { return key; }
+	bool operator==(const BenchElement& other) const { return key == other.key; }
+	bool operator<(const BenchElement& other) const { return key < other.key; }
+};
+
+class HashTableAdaptor {
+protected:
+	HashTable<BenchElement> table;
+
+public:
+	static const char* name() { return "HashTable"; }
+	void insert(int key) {
+		BenchElement element = { key, key };
+		table.insert(&element, key);
+	}
+	bool find(int key) {
+		BenchElement element = { key, 0 };
+		return table.find(&element, key) != nullptr;
+	}
+	void remove(int key) {
+		BenchElement element = { key, 0 };
+		table.remove(&element, key);
+	}
+	long findMany(const int* keys, int n, bool interleaved) {
+		Node<BenchElement>* out[PROBE_BATCH];
+		return interleaved ? table.findManyInterleaved(keys, n, out) : table.findMany(keys, n, out);
+	}
+};
+
+/*same table with the bloom filter front-end, misses should mostly stop at the filter*/
+class FilteredHashTableAdaptor : public HashTableAdaptor {
+public:
+	FilteredHashTableAdaptor() { table.enableFilter(); }
+	static const char* name() { return "HashTable+bloom"; }
+};
+
+/*two buckets per key instead of a chain, compare the p99 of hit_lookup/miss_lookup with HashTable's*/
+class CuckooHashTableAdaptor {
+	CuckooHashTable<BenchElement> table;
+
+public:
+	static const char* name() { return "CuckooHashTable"; }
+	void insert(int key) { table.insert(BenchElement{ key, key }, key); }
+	bool find(int key) { return table.find(BenchElement{ key, 0 }, key) != nullptr; }
+	void remove(int key) { table.remove(BenchElement{ key, 0 }, key); }
+};
+
+/*every element is also linked into the timer wheel, nothing expires during a run - this is the cost of the wheel*/
+class ExpiringHashTableAdaptor {
+	ExpiringHashTable<BenchElement> table;
+
+public:
+	static const char* name() { return "ExpiringHashTable"; }
+	void insert(int key) { table.insert(BenchElement{ key, key }, key, std::chrono::hours(1)); }
+	bool find(int key) {
+		BenchElement out;
+		return table.get(BenchElement{ key, 0 }, key, out);
+	}
+	void remove(int key) { table.remove(BenchElement{ key, 0 }, key); }
+};
+
+class UnorderedMapAdaptor {
+	std::unordered_map<int, int> map;
+
+public:
+	static const char* name() { return "std::unordered_map"; }
+	void insert(int key) { map.emplace(key, key); }
+	bool find(int key) { return map.find(key) != map.end(); }
+	void remove(int key) { map.erase(key); }
+};
+
+/*lists keep a handle per element so random inserts/removes dont need a search*/
+class ListAdaptor {
+	List<int> list;
+
+public:
+	typedef Node<int>* Handle;
+	static const char* name() { return "List"; }
+	Handle pushBack(int key) {
+		list.insertBeforeNode(key, list.getTail());
+		return list.getTail()->prev;
+	}
+	Handle insertBefore(Handle pos, int key) {
+		list.insertBeforeNode(key, pos);
+		return pos->prev;
+	}
+	void remove(Handle handle) { list.remove(handle); }
+	void pushFront(int key) { list.insestAfterNode(key, list.getHead()); }
+	void popFront() {
+		if (list.getSize() > 0) list.destroyNode(list.pop_front());
+	}
+	void removeKey(int key) {
+		Node<int>* node = list.find(key);
+		if (node != nullptr) list.remove(node);
+	}
+	bool find(int key) { return list.find(key) != nullptr; }
+	long scan(Handle from, int length) {
+		long sum = 0;
+		for (int i = 0; i < length && from != list.getTail(); i++, from = from->next) sum += from->data;
+		return sum;
+	}
+};
+
+class StdListAdaptor {
+	std::list<int> list;
+
+public:
+	typedef std::list<int>::iterator Handle;
+	static const char* name() { return "std::list"; }
+	Handle pushBack(int key) { return list.insert(list.end(), key); }
+	Handle insertBefore(Handle pos, int key) { return list.insert(pos, key); }
+	void remove(Handle handle) { list.erase(handle); }
+	void pushFront(int key) { list.push_front(key); }
+	void popFront() {
+		if (!list.empty()) list.pop_front();
+	}
+	void removeKey(int key) {
+		Handle it = std::find(list.begin(), list.end(), key);
+		if (it != list.end()) list.erase(it);
+	}
+	bool find(int key) { return std::find(list.begin(), list.end(), key) != list.end(); }
+	long scan(Handle from, int length) {
+		long sum = 0;
+		for (int i = 0; i < length && from != list.end(); i++, ++from) sum += *from;
+		return sum;
+	}
+};
+
+/*Vector holds pointers, the pointed ints live in a pool owned by the adaptor*/
+class VectorAdaptor {
+	Vector<int>* vector;
+	std::vector<int> pool;
+	long count;
+
+public:
+	static const char* name() { return "Vector"; }
+	VectorAdaptor() : vector(new Vector<int>()), count(0) {}
+	~VectorAdaptor() { delete vector; }
+	void reserve(long n) { pool.resize(n); }
+	void pushBack(int key) {
+		pool[count] = key;
+		vector->add((int)count, &pool[count]);
+		count++;
+	}
+	int at(long i) { return (*vector)[(int)i]; }
+	void set(long i, int key) { //pool must hold index i
+		pool[i] = key;
+		vector->add((int)i, &pool[i]);
+	}
+	void clear() {
+		delete vector;
+		vector = new Vector<int>();
+		count = 0;
+	}
+};
+
+class StdVectorAdaptor {
+	std::vector<int*> vector; //same payload as Vector
+	std::vector<int> pool;
+
+public:
+	static const char* name() { return "std::vector"; }
+	void reserve(long n) { pool.resize(n); }
+	void pushBack(int key) {
+		pool[vector.size()] = key;
+		vector.push_back(&pool[vector.size()]);
+	}
+	int at(long i) { return *vector[i]; }
+	void set(long i, int key) {
+		if (i >= (long)vector.size()) vector.resize(i + 1, nullptr);
+		pool[i] = key;
+		vector[i] = &pool[i];
+	}
+	void clear() { std::vector<int*>().swap(vector); }
+};
+
+/********************************** SCENARIOS **********************************/
+/*keyed containers (ordered maps and hash tables)*/
+template<class A>
+static void seqInsert(long n, Result& result) {
+	A container;
+	std::vector<int> keys = makeKeys(n, false);
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) recorder.op([&] { container.insert(keys[i]); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void randInsert(long n, Result& result) {
+	A container;
+	std::vector<int> keys = makeKeys(n, true);
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) recorder.op([&] { container.insert(keys[i]); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void lookup(long n, Result& result, bool hit) {
+	A container;
+	std::vector<int> keys = makeKeys(n, true);
+	for (long i = 0; i < n; i++) container.insert(keys[i]);
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+	int miss = hit ? 0 : 1; //odd keys are never inserted
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) recorder.op([&] { sink = sink + container.find(keys[i] - miss); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void hitLookup(long n, Result& result) {
+	lookup<A>(n, result, true);
+}
+
+template<class A>
+static void missLookup(long n, Result& result) {
+	lookup<A>(n, result, false);
+}
+
+template<class A>
+static void removeAll(long n, Result& result) {
+	A container;
+	std::vector<int> keys = makeKeys(n, true);
+	for (long i = 0; i < n; i++) container.insert(keys[i]);
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) recorder.op([&] { container.remove(keys[i]); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*80% lookups, 10% inserts, 10% removes over a key space twice the initial size*/
+template<class A>
+static void mixed(long n, Result& result) {
+	A container;
+	std::vector<int> keys = makeKeys(n, true);
+	for (long i = 0; i < n / 2; i++) container.insert(keys[i]);
+	std::mt19937 rng(9);
+	std::vector<int> ops(n);
+	for (long i = 0; i < n; i++) ops[i] = (int)(rng() % 10);
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) {
+		int key = keys[(i * 7) % n];
+		if (ops[i] == 0) recorder.op([&] { container.insert(key); });
+		else if (ops[i] == 1) recorder.op([&] { container.remove(key); });
+		else recorder.op([&] { sink = sink + container.find(key); });
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*hit lookups PROBE_BATCH keys per call, ops counts keys so it compares with hit_lookup (the latencies are per call)*/
+template<class A, bool Interleaved>
+static void batchLookup(long n, Result& result) {
+	A container;
+	std::vector<int> keys = makeKeys(n, true);
+	for (long i = 0; i < n; i++) container.insert(keys[i]);
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+	Recorder recorder(n / PROBE_BATCH + 1);
+	recorder.begin();
+	for (long i = 0; i < n; i += PROBE_BATCH) {
+		int batch = n - i < PROBE_BATCH ? (int)(n - i) : PROBE_BATCH;
+		recorder.op([&] { sink = sink + container.findMany(&keys[i], batch, Interleaved); });
+	}
+	recorder.end();
+	recorder.fill(result);
+	result.ops = n;
+}
+
+template<class A>
+static void rangeScan(long n, Result& result) {
+	A container;
+	std::vector<int> keys = makeKeys(n, true);
+	for (long i = 0; i < n; i++) container.insert(keys[i]);
+	long scans = n / SCAN_LENGTH + 1;
+	Recorder recorder(scans);
+	recorder.begin();
+	for (long i = 0; i < scans; i++) recorder.op([&] { sink = sink + container.scan(keys[i % n], SCAN_LENGTH); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*grows to n and shrinks back to empty twice, crossing every resize threshold*/
+template<class A>
+static void rehashStress(long n, Result& result) {
+	A container;
+	std::vector<int> keys = makeKeys(n, true);
+	Recorder recorder(4 * n);
+	recorder.begin();
+	for (int round = 0; round < 2; round++) {
+		for (long i = 0; i < n; i++) recorder.op([&] { container.insert(keys[i]); });
+		for (long i = 0; i < n; i++) recorder.op([&] { container.remove(keys[i]); });
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*lists*/
+template<class A>
+static void listSeqInsert(long n, Result& result) {
+	A list;
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) recorder.op([&] { list.pushBack((int)i); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void listRandInsert(long n, Result& result) {
+	A list;
+	std::vector<typename A::Handle> handles;
+	handles.reserve(n);
+	handles.push_back(list.pushBack(0));
+	std::mt19937 rng(3);
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 1; i < n; i++) {
+		typename A::Handle pos = handles[rng() % handles.size()];
+		recorder.op([&] { handles.push_back(list.insertBefore(pos, (int)i)); });
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void listLookup(long n, Result& result, bool hit) {
+	A list;
+	for (long i = 0; i < n; i++) list.pushBack((int)(2 * i + 2));
+	long ops = std::max(16L, (long)LIST_FIND_BUDGET / n);
+	std::mt19937 rng(5);
+	Recorder recorder(ops);
+	recorder.begin();
+	for (long i = 0; i < ops; i++) {
+		int key = (int)(2 * (rng() % n) + 2) - (hit ? 0 : 1);
+		recorder.op([&] { sink = sink + list.find(key); });
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void listHitLookup(long n, Result& result) {
+	listLookup<A>(n, result, true);
+}
+
+template<class A>
+static void listMissLookup(long n, Result& result) {
+	listLookup<A>(n, result, false);
+}
+
+template<class A>
+static void listRemove(long n, Result& result) {
+	A list;
+	std::vector<typename A::Handle> handles;
+	for (long i = 0; i < n; i++) handles.push_back(list.pushBack((int)i));
+	std::shuffle(handles.begin(), handles.end(), std::mt19937(7));
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) recorder.op([&] { list.remove(handles[i]); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*half inserts at the tail, half removes of a random element*/
+template<class A>
+static void listMixed(long n, Result& result) {
+	A list;
+	std::vector<typename A::Handle> handles;
+	for (long i = 0; i < n / 2; i++) handles.push_back(list.pushBack((int)i));
+	std::mt19937 rng(9);
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) {
+		if ((rng() & 1) || handles.empty()) {
+			recorder.op([&] { handles.push_back(list.pushBack((int)i)); });
+		}
+		else {
+			size_t index = rng() % handles.size();
+			typename A::Handle handle = handles[index];
+			handles[index] = handles.back();
+			handles.pop_back();
+			recorder.op([&] { list.remove(handle); });
+		}
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void listRangeScan(long n, Result& result) {
+	A list;
+	std::vector<typename A::Handle> handles;
+	for (long i = 0; i < n; i++) handles.push_back(list.pushBack((int)i));
+	long scans = n / SCAN_LENGTH + 1;
+	std::mt19937 rng(11);
+	Recorder recorder(scans);
+	recorder.begin();
+	for (long i = 0; i < scans; i++) {
+		typename A::Handle from = handles[rng() % n];
+		recorder.op([&] { sink = sink + list.scan(from, SCAN_LENGTH); });
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*vectors*/
+template<class A>
+static void vectorSeqInsert(long n, Result& result) {
+	A vector;
+	vector.reserve(n);
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) recorder.op([&] { vector.pushBack((int)i); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void vectorHitLookup(long n, Result& result) {
+	A vector;
+	vector.reserve(n);
+	for (long i = 0; i < n; i++) vector.pushBack((int)i);
+	std::mt19937 rng(5);
+	std::vector<long> indices(n);
+	for (long i = 0; i < n; i++) indices[i] = (long)(rng() % n);
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) recorder.op([&] { sink = sink + vector.at(indices[i]); });
+	recorder.end();
+	recorder.fill(result);
+}
+
+template<class A>
+static void vectorRangeScan(long n, Result& result) {
+	A vector;
+	vector.reserve(n);
+	for (long i = 0; i < n; i++) vector.pushBack((int)i);
+	long scans = n / SCAN_LENGTH + 1;
+	std::mt19937 rng(11);
+	Recorder recorder(scans);
+	recorder.begin();
+	for (long i = 0; i < scans; i++) {
+		long from = (long)(rng() % n);
+		recorder.op([&] {
+			long sum = 0;
+			for (long j = from; j < from + SCAN_LENGTH && j < n; j++) sum += vector.at(j);
+			sink = sink + sum;
+		});
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*builds the vector from empty 4 times so every growth step is hit again*/
+template<class A>
+static void vectorResizeStress(long n, Result& result) {
+	A vector;
+	vector.reserve(n);
+	Recorder recorder(4 * n);
+	recorder.begin();
+	for (int round = 0; round < 4; round++) {
+		vector.clear();
+		for (long i = 0; i < n; i++) recorder.op([&] { vector.pushBack((int)i); });
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*work queues - producers push total messages, one consumer drains them.
+  the baseline is the current setup: List::push_front/pop_front behind a mutex*/
+class MutexListQueue {
+	List<long> list;
+	std::mutex lock;
+
+public:
+	static const char* name() { return "mutex+List"; }
+	bool push(long value) {
+		std::lock_guard<std::mutex> guard(lock);
+		list.insestAfterNode(value, list.getHead());
+		return true;
+	}
+	bool pop(long& value) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (list.getSize() == 0) return false;
+		Node<long>* node = list.pop_front();
+		value = node->data;
+		list.destroyNode(node);
+		return true;
+	}
+};
+
+class MPMCAdaptor {
+	MPMCQueue<long> queue;
+
+public:
+	static const char* name() { return "MPMCQueue"; }
+	MPMCAdaptor() : queue(1 << 16) {}
+	bool push(long value) { return queue.enqueue(value); }
+	bool pop(long& value) { return queue.dequeue(value); }
+};
+
+/*MPSC is intrusive - every producer owns its nodes, so nothing is allocated while running*/
+class MPSCAdaptor {
+	MPSCQueue<long> queue;
+
+public:
+	static const char* name() { return "MPSCQueue"; }
+	void push(QueueNode<long>* node) { queue.push(node); }
+	QueueNode<long>* pop() { return queue.pop(); }
+};
+
+template<class Q>
+static void queueProducers(long n, int producers, Result& result) {
+	Q queue;
+	long per_producer = n / producers;
+	std::vector<std::thread> threads;
+	Recorder recorder(per_producer); //latency of producer 0's pushes
+	recorder.begin();
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&, p] {
+			for (long i = 0; i < per_producer; i++) {
+				if (p == 0) recorder.op([&] { while (!queue.push(i)) std::this_thread::yield(); });
+				else while (!queue.push(i)) std::this_thread::yield();
+			}
+		});
+	}
+	long value, received = 0;
+	while (received < per_producer * producers) {
+		if (queue.pop(value)) received++;
+	}
+	for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+	recorder.end();
+	recorder.fill(result);
+	result.ops = per_producer * producers;
+}
+
+template<>
+void queueProducers<MPSCAdaptor>(long n, int producers, Result& result) {
+	MPSCAdaptor queue;
+	long per_producer = n / producers;
+	std::vector<QueueNode<long>> nodes(per_producer * producers);
+	std::vector<std::thread> threads;
+	Recorder recorder(per_producer);
+	recorder.begin();
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&, p] {
+			QueueNode<long>* own = &nodes[p * per_producer];
+			for (long i = 0; i < per_producer; i++) {
+				if (p == 0) recorder.op([&] { queue.push(&own[i]); });
+				else queue.push(&own[i]);
+			}
+		});
+	}
+	long received = 0;
+	while (received < per_producer * producers) {
+		if (queue.pop() != nullptr) received++;
+	}
+	for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+	recorder.end();
+	recorder.fill(result);
+	result.ops = per_producer * producers;
+}
+
+/*read mostly tables - a HashTable behind one mutex against RcuHashTable, whose readers take no lock*/
+class MutexHashTableAdaptor {
+	HashTable<BenchElement> table;
+	std::mutex lock;
+
+public:
+	static const char* name() { return "mutex+HashTable"; }
+	int registerReader() { return 0; }
+	void unregisterReader(int) {}
+	void insert(int key) {
+		std::lock_guard<std::mutex> guard(lock);
+		BenchElement element = { key, key };
+		table.insert(&element, key);
+	}
+	void replace(int key, int value) {
+		std::lock_guard<std::mutex> guard(lock);
+		BenchElement element = { key, value };
+		Node<BenchElement>* found = table.find(&element, key);
+		if (found != nullptr) found->data.value = value;
+	}
+	int get(int, int key) {
+		std::lock_guard<std::mutex> guard(lock);
+		BenchElement element = { key, 0 };
+		Node<BenchElement>* found = table.find(&element, key);
+		return found != nullptr ? found->data.value : 0;
+	}
+};
+
+class RcuHashTableAdaptor {
+	RcuHashTable<BenchElement> table;
+
+public:
+	static const char* name() { return "RcuHashTable"; }
+	int registerReader() { return table.registerReader(); }
+	void unregisterReader(int reader) { table.unregisterReader(reader); }
+	void insert(int key) { table.insert({ key, key }, key); }
+	void replace(int key, int value) { table.replace({ key, value }, key); }
+	int get(int reader, int key) {
+		BenchElement found = { key, 0 };
+		table.get(reader, found, key, found);
+		return found.value;
+	}
+};
+
+/*readers split n lookups while one writer updates a value every WRITE_PAUSE_US until they are done*/
+template<class A>
+static void readMostly(long n, int readers, Result& result) {
+	A table;
+	std::vector<int> keys = makeKeys(n, true);
+	for (long i = 0; i < n; i++) table.insert(keys[i]);
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+	long per_reader = n / readers;
+	std::atomic<bool> done(false);
+	std::thread writer([&] {
+		for (long i = 0; !done.load(std::memory_order_relaxed); i++) {
+			table.replace(keys[i % n], (int)i);
+			std::this_thread::sleep_for(std::chrono::microseconds(WRITE_PAUSE_US));
+		}
+	});
+	std::vector<std::thread> threads;
+	Recorder recorder(per_reader); //latency of reader 0's lookups
+	recorder.begin();
+	for (int r = 0; r < readers; r++) {
+		threads.emplace_back([&, r] {
+			int reader = table.registerReader();
+			for (long i = r * per_reader; i < (r + 1) * per_reader; i++) {
+				if (r == 0) recorder.op([&] { sink = sink + table.get(reader, keys[i]); });
+				else sink = sink + table.get(reader, keys[i]);
+			}
+			table.unregisterReader(reader);
+		});
+	}
+	for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+	recorder.end();
+	done.store(true);
+	writer.join();
+	recorder.fill(result);
+	result.ops = per_reader * readers;
+}
+
+/*HashTable::build from a Vector, the whole build is one op so ops/s is elements per second*/
+static void hashTableBulkBuild(long n, int threads, Result& result) {
+	std::vector<int> keys = makeKeys(n, true);
+	std::vector<BenchElement> elements(n);
+	Vector<BenchElement> input;
+	for (long i = 0; i < n; i++) {
+		elements[i] = { keys[i], keys[i] };
+		input.add((int)i, &elements[i]);
+	}
+	HashTable<BenchElement> table;
+	Recorder recorder(1);
+	recorder.begin();
+	recorder.op([&] { table.build(input, (int)n, threads); });
+	recorder.end();
+	recorder.fill(result);
+	result.ops = n;
+}
+
+/********************************** REPLAY **********************************/
+/*a trace runs closed loop (next op as soon as the last one returns), its recorded gaps are not replayed.
+  keys are cut to int like every other scenario*/
+template<class A>
+static void replayKeyed(const TraceReader& trace, Result& result) {
+	A container;
+	long n = (long)trace.getCount();
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) {
+		int key = (int)trace[i].key;
+		switch ((TraceOp)trace[i].op) {
+		case TraceOp::INSERT: recorder.op([&] { container.insert(key); }); break;
+		case TraceOp::REMOVE: recorder.op([&] { container.remove(key); }); break;
+		default: recorder.op([&] { sink = sink + container.find(key); }); break;
+		}
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*REMOVE finds the first element with the key, like the traced program had to*/
+template<class A>
+static void replayList(const TraceReader& trace, Result& result) {
+	A list;
+	long n = (long)trace.getCount();
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) {
+		int key = (int)trace[i].key;
+		switch ((TraceOp)trace[i].op) {
+		case TraceOp::PUSH_FRONT: recorder.op([&] { list.pushFront(key); }); break;
+		case TraceOp::PUSH_BACK: recorder.op([&] { list.pushBack(key); }); break;
+		case TraceOp::POP_FRONT: recorder.op([&] { list.popFront(); }); break;
+		case TraceOp::REMOVE: recorder.op([&] { list.removeKey(key); }); break;
+		default: recorder.op([&] { sink = sink + list.find(key); }); break;
+		}
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+/*INSERT stores the index as the value, GET reads it back. every index is filled before the clock starts -
+  a TracedVector may wrap a Vector that already held data, so the trace can GET indices it never INSERTed*/
+template<class A>
+static void replayVector(const TraceReader& trace, Result& result) {
+	A vector;
+	long n = (long)trace.getCount();
+	long max_index = 0;
+	for (long i = 0; i < n; i++) max_index = std::max(max_index, (long)trace[i].key);
+	vector.reserve(max_index + 1);
+	for (long i = 0; i <= max_index; i++) vector.set(i, (int)i);
+	Recorder recorder(n);
+	recorder.begin();
+	for (long i = 0; i < n; i++) {
+		long index = (long)trace[i].key;
+		if ((TraceOp)trace[i].op == TraceOp::INSERT) recorder.op([&] { vector.set(index, (int)index); });
+		else recorder.op([&] { sink = sink + vector.at(index); });
+	}
+	recorder.end();
+	recorder.fill(result);
+}
+
+typedef void (*ReplayFunc)(const TraceReader&, Result&);
+
+struct ReplayCase {
+	TraceSource source; //keyed cases are tagged AVL_TREE and also take HASH_TABLE traces
+	const char* container;
+	ReplayFunc run;
+};
+
+#define KEYED_REPLAY(A) { TraceSource::AVL_TREE, A::name(), replayKeyed<A> }
+
+static const ReplayCase replay_cases[] = {
+	KEYED_REPLAY(AvlAdaptor),
+	KEYED_REPLAY(RelaxedAvlAdaptor),
+	KEYED_REPLAY(BPlusTreeAdaptor),
+	KEYED_REPLAY(RadixTreeAdaptor),
+	KEYED_REPLAY(MapAdaptor),
+	KEYED_REPLAY(HashTableAdaptor),
+	KEYED_REPLAY(FilteredHashTableAdaptor),
+	KEYED_REPLAY(CuckooHashTableAdaptor),
+	KEYED_REPLAY(ExpiringHashTableAdaptor),
+	KEYED_REPLAY(UnorderedMapAdaptor),
+	{ TraceSource::LIST, ListAdaptor::name(), replayList<ListAdaptor> },
+	{ TraceSource::LIST, StdListAdaptor::name(), replayList<StdListAdaptor> },
+	{ TraceSource::VECTOR, VectorAdaptor::name(), replayVector<VectorAdaptor> },
+	{ TraceSource::VECTOR, StdVectorAdaptor::name(), replayVector<StdVectorAdaptor> }
+};
+
+/********************************** DRIVER **********************************/
+typedef void (*ScenarioFunc)(long, Result&);
+
+struct Case {
+	const char* container;
+	const char* scenario;
+	ScenarioFunc run;
+};
+
+#define KEYED_CASES(A) \
+	{ A::name(), "seq_insert", seqInsert<A> }, \
+	{ A::name(), "rand_insert", randInsert<A> }, \
+	{ A::name(), "hit_lookup", hitLookup<A> }, \
+	{ A::name(), "miss_lookup", missLookup<A> }, \
+	{ A::name(), "remove", removeAll<A> }, \
+	{ A::name(), "mixed", mixed<A> }
+
+#define LIST_CASES(A) \
+	{ A::name(), "seq_insert", listSeqInsert<A> }, \
+	{ A::name(), "rand_insert", listRandInsert<A> }, \
+	{ A::name(), "hit_lookup", listHitLookup<A> }, \
+	{ A::name(), "miss_lookup", listMissLookup<A> }, \
+	{ A::name(), "remove", listRemove<A> }, \
+	{ A::name(), "mixed", listMixed<A> }, \
+	{ A::name(), "range_scan", listRangeScan<A> }
+
+#define VECTOR_CASES(A) \
+	{ A::name(), "seq_insert", vectorSeqInsert<A> }, \
+	{ A::name(), "hit_lookup", vectorHitLookup<A> }, \
+	{ A::name(), "range_scan", vectorRangeScan<A> }, \
+	{ A::name(), "resize_stress", vectorResizeStress<A> }
+
+static const Case cases[] = {
+	KEYED_CASES(AvlAdaptor),
+	{ AvlAdaptor::name(), "range_scan", rangeScan<AvlAdaptor> },
+	KEYED_CASES(RelaxedAvlAdaptor),
+	KEYED_CASES(BPlusTreeAdaptor),
+	{ BPlusTreeAdaptor::name(), "range_scan", rangeScan<BPlusTreeAdaptor> },
+	KEYED_CASES(RadixTreeAdaptor),
+	{ RadixTreeAdaptor::name(), "range_scan", rangeScan<RadixTreeAdaptor> },
+	KEYED_CASES(MapAdaptor),
+	{ MapAdaptor::name(), "range_scan", rangeScan<MapAdaptor> },
+	KEYED_CASES(HashTableAdaptor),
+	{ HashTableAdaptor::name(), "rehash_stress", rehashStress<HashTableAdaptor> },
+	{ HashTableAdaptor::name(), "batch_lookup", batchLookup<HashTableAdaptor, false> },
+	{ HashTableAdaptor::name(), "amac_lookup", batchLookup<HashTableAdaptor, true> },
+	{ FilteredHashTableAdaptor::name(), "hit_lookup", hitLookup<FilteredHashTableAdaptor> },
+	{ FilteredHashTableAdaptor::name(), "miss_lookup", missLookup<FilteredHashTableAdaptor> },
+	KEYED_CASES(CuckooHashTableAdaptor),
+	{ CuckooHashTableAdaptor::name(), "rehash_stress", rehashStress<CuckooHashTableAdaptor> },
+	KEYED_CASES(ExpiringHashTableAdaptor),
+	KEYED_CASES(UnorderedMapAdaptor),
+	{ UnorderedMapAdaptor::name(), "rehash_stress", rehashStress<UnorderedMapAdaptor> },
+	LIST_CASES(ListAdaptor),
+	LIST_CASES(StdListAdaptor),
+	VECTOR_CASES(VectorAdaptor),
+	VECTOR_CASES(StdVectorAdaptor)
+};
+
+static void printResult(FILE* out, const Result& result) {
+	fprintf(out, "{\"container\":\"%s\",\"scenario\":\"%s\",\"size\":%ld,\"threads\":%d,\"ops\":%ld,"
+		"\"seconds\":%.6f,\"ops_per_sec\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"peak_rss_kb\":%ld}",
+		result.container.c_str(), result.scenario.c_str(), result.size, result.threads, result.ops,
+		result.seconds, result.seconds > 0 ? result.ops / result.seconds : 0.0,
+		result.p50_ns, result.p99_ns, result.peak_rss_kb);
+}
+
+/*runs f in a child process (so peak RSS is per case) and prints its result to stdout*/
+template<class F>
+static void runIsolated(Result result, F f, bool& first) {
+	char line[1024] = { 0 };
+#ifndef _WIN32
+	int fds[2];
+	if (pipe(fds) != 0) return;
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		alarm(case_timeout);
+		f(result);
+		result.peak_rss_kb = peakRssKb();
+		FILE* out = fdopen(fds[1], "w");
+		printResult(out, result);
+		fclose(out);
+		_exit(0);
+	}
+	close(fds[1]);
+	size_t length = 0;
+	ssize_t got;
+	while (length < sizeof(line) - 1 && (got = read(fds[0], line + length, sizeof(line) - 1 - length)) > 0) {
+		length += (size_t)got;
+	}
+	close(fds[0]);
+	int status = 0;
+	waitpid(pid, &status, 0);
+	if (length == 0) {
+		fprintf(stderr, "case %s/%s/%ld failed or timed out\n", result.container.c_str(), result.scenario.c_str(), result.size);
+		return;
+	}
+	printf("%s\n  %s", first ? "" : ",", line);
+#else
+	f(result);
+	result.peak_rss_kb = peakRssKb();
+	printf("%s\n  ", first ? "" : ",");
+	printResult(stdout, result);
+#endif
+	first = false;
+}
+
+/*prints text as a quoted JSON string*/
+static void printJsonString(FILE* out, const char* text) {
+	fputc('"', out);
+	for (const unsigned char* c = (const unsigned char*)text; *c != 0; c++) {
+		if (*c == '"' || *c == '\\') fprintf(out, "\\%c", *c);
+		else if (*c < 0x20) fprintf(out, "\\u%04x", *c);
+		else fputc(*c, out);
+	}
+	fputc('"', out);
+}
+
+/*replays the trace against every container of its kind, the recorded rate goes to stderr for comparison*/
+static int runReplay(const char* path, const char* filter) {
+	TraceReader trace;
+	if (!trace.open(path)) {
+		fprintf(stderr, "%s is not a readable trace\n", path);
+		return 1;
+	}
+	TraceSource source = trace.getSource() == TraceSource::HASH_TABLE ? TraceSource::AVL_TREE : trace.getSource();
+	double recorded_seconds = trace.getDurationNs() / 1e9;
+	fprintf(stderr, "trace %s: %llu ops in %.6f s when recorded (%.1f ops/s)\n", path,
+		(unsigned long long)trace.getCount(), recorded_seconds,
+		recorded_seconds > 0 ? trace.getCount() / recorded_seconds : 0.0);
+
+	bool first = true;
+	printf("{\"benchmark\":\"data-structures\",\"trace\":");
+	printJsonString(stdout, path);
+	printf(",\"results\":[");
+	for (size_t c = 0; c < sizeof(replay_cases) / sizeof(replay_cases[0]); c++) {
+		if (replay_cases[c].source != source) continue;
+		std::string label = std::string(replay_cases[c].container) + "/replay";
+		if (label.find(filter) == std::string::npos) continue;
+		Result result = Result();
+		result.container = replay_cases[c].container;
+		result.scenario = "replay";
+		result.size = (long)trace.getCount();
+		result.threads = 1;
+		ReplayFunc run = replay_cases[c].run;
+		runIsolated(result, [run, &trace](Result& r) { run(trace, r); }, first);
+	}
+	printf("\n]}\n");
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	long min_size = 1 << 10;
+	long max_size = 1 << 22;
+	const char* filter = "";
+	const char* replay = nullptr;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "--min-size") == 0) min_size = atol(argv[i + 1]);
+		else if (strcmp(argv[i], "--max-size") == 0) max_size = atol(argv[i + 1]);
+		else if (strcmp(argv[i], "--filter") == 0) filter = argv[i + 1];
+		else if (strcmp(argv[i], "--timeout") == 0) case_timeout = (unsigned)atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--replay") == 0) replay = argv[i + 1];
+	}
+	if (replay != nullptr) return runReplay(replay, filter);
+
+	bool first = true;
+	printf("{\"benchmark\":\"data-structures\",\"results\":[");
+	for (long size = min_size; size <= max_size; size *= 8) {
+		for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+			std::string label = std::string(cases[c].container) + "/" + cases[c].scenario;
+			if (label.find(filter) == std::string::npos) continue;
+			Result result = Result();
+			result.container = cases[c].container;
+			result.scenario = cases[c].scenario;
+			result.size = size;
+			result.threads = 1;
+			ScenarioFunc run = cases[c].run;
+			runIsolated(result, [run, size](Result& r) { run(size, r); }, first);
+		}
+	}
+
+	/*producer scaling - fixed amount of messages, growing number of producers*/
+	long messages = max_size < (1 << 20) ? max_size : (1 << 20);
+	for (int producers = 1; producers <= 8; producers *= 2) {
+		Result result = Result();
+		result.scenario = "queue_producers";
+		result.size = messages;
+		result.threads = producers;
+		const char* names[] = { MutexListQueue::name(), MPSCAdaptor::name(), MPMCAdaptor::name() };
+		for (int q = 0; q < 3; q++) {
+			result.container = names[q];
+			if ((result.container + "/" + result.scenario).find(filter) == std::string::npos) continue;
+			runIsolated(result, [q, messages, producers](Result& r) {
+				if (q == 0) queueProducers<MutexListQueue>(messages, producers, r);
+				else if (q == 1) queueProducers<MPSCAdaptor>(messages, producers, r);
+				else queueProducers<MPMCAdaptor>(messages, producers, r);
+			}, first);
+		}
+	}
+	/*reader scaling on a read mostly table - same lookups, growing number of readers*/
+	for (int readers = 1; readers <= 8; readers *= 2) {
+		Result result = Result();
+		result.scenario = "read_mostly";
+		result.size = max_size;
+		result.threads = readers;
+		const char* names[] = { MutexHashTableAdaptor::name(), RcuHashTableAdaptor::name() };
+		for (int t = 0; t < 2; t++) {
+			result.container = names[t];
+			if ((result.container + "/" + result.scenario).find(filter) == std::string::npos) continue;
+			runIsolated(result, [t, max_size, readers](Result& r) {
+				if (t == 0) readMostly<MutexHashTableAdaptor>(max_size, readers, r);
+				else readMostly<RcuHashTableAdaptor>(max_size, readers, r);
+			}, first);
+		}
+	}
+	/*bulk build scaling - same input, growing number of build threads*/
+	int hardware = (int)std::thread::hardware_concurrency();
+	for (int threads = 1; threads <= (hardware > 1 ? hardware : 1); threads *= 2) {
+		Result result = Result();
+		result.container = HashTableAdaptor::name();
+		result.scenario = "bulk_build";
+		result.size = max_size;
+		result.threads = threads;
+		if ((result.container + "/" + result.scenario).find(filter) == std::string::npos) continue;
+		runIsolated(result, [threads, max_size](Result& r) { hashTableBulkBuild(max_size, threads, r); }, first);
+	}
+	printf("\n]}\n");
+	return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef BENCHMARK_CHECK_H
+#define BENCHMARK_CHECK_H
+
+#include <atomic>
+#include <cstdio>
+
+/*checks for the ctest targets - they are built in Release like everything else, so assert would be
+  compiled out. the first failed check is reported, the test returns checkResult() from main*/
+static std::atomic<bool> failed(false);
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition) && !failed.exchange(true)) { \
+			fprintf(stderr, "%s: check failed at line %d: %s\n", __FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+static inline int checkResult() {
+	return failed.load() ? 1 : 0;
+}
+
+#endif // !BENCHMARK_CHECK_H
@@ -0,0 +1,57 @@
+/*CuckooHashTable's per key limit - elements that share a key share both buckets at every size, so past
+  CUCKOO_KEY_LIMIT of them insert has to fail instead of doubling the table forever*/
+#include "../HashTable/cuckooHashTable.h"
+#include "check.h"
+
+#include <cstdio>
+
+/*every element has key 7 unless it says otherwise, id tells them apart*/
+struct SharedKeyElement {
+	int id;
+	int key;
+
+	int operator()() const {
+		return key;
+	}
+	bool operator==(const SharedKeyElement& other) const {
+		return id == other.id;
+	}
+};
+
+int main() {
+	CuckooHashTable<SharedKeyElement> table;
+	int placed = 0;
+	for (int i = 0; i < CUCKOO_KEY_LIMIT + 8; i++) {
+		SharedKeyElement* element = table.insert(SharedKeyElement{ i, 7 }, 7);
+		CHECK((element != nullptr) == (i < CUCKOO_KEY_LIMIT));
+		placed += element != nullptr;
+	}
+	CHECK(placed == CUCKOO_KEY_LIMIT && table.getCount() == CUCKOO_KEY_LIMIT);
+	CHECK(table.getSize() <= 1 << 16); //the rejected inserts did not keep growing the table
+	for (int i = 0; i < CUCKOO_KEY_LIMIT; i++) {
+		SharedKeyElement* found = table.find(SharedKeyElement{ i, 7 }, 7);
+		CHECK(found != nullptr && found->id == i);
+	}
+	CHECK(table.find(SharedKeyElement{ CUCKOO_KEY_LIMIT, 7 }, 7) == nullptr);
+	CHECK(table.insert(SharedKeyElement{ 3, 7 }, 7) == nullptr); //still a duplicate, not a new element
+
+	CHECK(table.remove(SharedKeyElement{ 0, 7 }, 7)); //a removed element frees room for one more
+	CHECK(table.insert(SharedKeyElement{ 1000, 7 }, 7) != nullptr);
+	CHECK(table.insert(SharedKeyElement{ 1001, 7 }, 7) == nullptr);
+
+	/*the full key shares the stash with many other keys, which still go in and grow the table*/
+	for (int i = 0; i < 100000; i++) {
+		CHECK(table.insert(SharedKeyElement{ 2000 + i, 100 + i }, 100 + i) != nullptr);
+	}
+	CHECK(table.getCount() == CUCKOO_KEY_LIMIT + 100000);
+	for (int i = 1; i < CUCKOO_KEY_LIMIT; i++) {
+		CHECK(table.find(SharedKeyElement{ i, 7 }, 7) != nullptr);
+	}
+	CHECK(table.find(SharedKeyElement{ 1000, 7 }, 7) != nullptr);
+	for (int i = 0; i < 100000; i++) {
+		CHECK(table.find(SharedKeyElement{ 2000 + i, 100 + i }, 100 + i) != nullptr);
+	}
+	printf("cuckooKeyLimit: limit %d, %d elements in %d buckets: %s\n", CUCKOO_KEY_LIMIT, table.getCount(),
+		table.getSize(), checkResult() ? "FAILED" : "ok");
+	return checkResult();
+}
@@ -0,0 +1,128 @@
+/*ExpiringHashTable's timer wheel against a reference map, driven by a fake clock. the clock jumps over
+  idle gaps far longer than the wheel's 2^24 tick span, which the wheel has to cross in one step - ctest's
+  timeout fails a wheel that walks them tick block by tick block (about 2^30 loop iterations per gap here)*/
+#include "../HashTable/expiringHashTable.h"
+#include "check.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+
+struct FakeClock {
+	typedef std::chrono::milliseconds duration;
+	typedef std::chrono::time_point<FakeClock, duration> time_point;
+	static long long ms;
+
+	static time_point now() {
+		return time_point(duration(ms));
+	}
+};
+long long FakeClock::ms = 0;
+
+struct TimedElement {
+	int id;
+	int value;
+
+	int operator()() const {
+		return id;
+	}
+	bool operator==(const TimedElement& other) const {
+		return id == other.id;
+	}
+};
+
+#define WHEEL_SPAN (1LL << (WHEEL_BITS * WHEEL_LEVELS))
+
+typedef std::map<int, std::pair<long long, int>> Reference; //id -> deadline, value
+
+static int liveCount(const Reference& reference) {
+	int live = 0;
+	for (Reference::const_iterator it = reference.begin(); it != reference.end(); ++it) {
+		live += it->second.first > FakeClock::ms;
+	}
+	return live;
+}
+
+/*random operations, now and then the clock jumps up to span ticks at once*/
+static void randomOps(int seed, long long span, long long max_ttl) {
+	FakeClock::ms = 0;
+	ExpiringHashTable<TimedElement, FakeClock> table; //1 ms ticks
+	Reference reference;
+	std::mt19937_64 rng(seed);
+	for (int i = 0; i < 200000 && !checkResult(); i++) {
+		int op = (int)(rng() % 100);
+		if (op < 2) FakeClock::ms += (long long)(rng() % span);
+		else if (op < 10) FakeClock::ms += (long long)(rng() % 64);
+		int id = (int)(rng() % 2000);
+		long long ttl = (long long)(rng() % max_ttl);
+		Reference::iterator it = reference.find(id);
+		bool live = it != reference.end() && it->second.first > FakeClock::ms;
+		TimedElement element = { id, i };
+		TimedElement out = { 0, 0 };
+		if (op < 40) {
+			bool inserted = table.insert(element, id, std::chrono::milliseconds(ttl));
+			CHECK(inserted == !live);
+			if (inserted) reference[id] = std::make_pair(FakeClock::ms + ttl, i);
+		}
+		else if (op < 80) {
+			CHECK(table.get(element, id, out) == live);
+			CHECK(!live || out.value == it->second.second);
+		}
+		else if (op < 90) {
+			bool touched = table.touch(element, id, std::chrono::milliseconds(ttl));
+			CHECK(touched == live);
+			if (touched) it->second.first = FakeClock::ms + ttl;
+		}
+		else {
+			CHECK(table.remove(element, id) == live);
+			reference.erase(id);
+		}
+		if (op == 99) {
+			table.expire();
+			CHECK(table.getCount() == liveCount(reference));
+		}
+	}
+	table.expire();
+	CHECK(table.getCount() == liveCount(reference));
+	FakeClock::ms += max_ttl;
+	table.expire();
+	CHECK(table.getCount() == 0);
+}
+
+/*one element parked far past the wheel keeps the table busy while short lived ones expire in the
+  middle of gaps of 2^36 ticks - each must be visible up to the tick before its deadline and gone at it*/
+static void idleGaps() {
+	FakeClock::ms = 0;
+	ExpiringHashTable<TimedElement, FakeClock> table;
+	long long gap = 1LL << 36;
+	int gaps = 200;
+	TimedElement out = { 0, 0 };
+	CHECK(table.insert(TimedElement{ 1, 1 }, 1, std::chrono::milliseconds(gap * (gaps + 1))));
+	for (int g = 1; g <= gaps && !checkResult(); g++) {
+		long long start = gap * g;
+		long long ttl = WHEEL_SPAN * 3 + g; //parked in the last level and cascaded down on the way
+		FakeClock::ms = start;
+		CHECK(table.insert(TimedElement{ 2, g }, 2, std::chrono::milliseconds(ttl)));
+		FakeClock::ms = start + ttl - 1;
+		CHECK(table.get(TimedElement{ 2, 0 }, 2, out) && out.value == g);
+		CHECK(table.getCount() == 2);
+		FakeClock::ms = start + ttl;
+		CHECK(!table.get(TimedElement{ 2, 0 }, 2, out));
+		CHECK(table.expire() == 0); //get already freed it on its way
+		CHECK(table.getCount() == 1);
+	}
+	FakeClock::ms = gap * (gaps + 1) - 1;
+	CHECK(table.get(TimedElement{ 1, 0 }, 1, out));
+	FakeClock::ms = gap * (gaps + 1);
+	CHECK(!table.get(TimedElement{ 1, 0 }, 1, out));
+	CHECK(table.getCount() == 0 && table.getExpired() == (uint64_t)gaps + 1);
+}
+
+int main() {
+	randomOps(1, 64, 5000); //short gaps, level 0 and 1
+	randomOps(2, 5000000, 20000000); //gaps and deadlines in every level
+	randomOps(3, WHEEL_SPAN * 4, WHEEL_SPAN * 8); //past the wheel's span, parked deadlines
+	idleGaps();
+	printf("expiringWheel: %s\n", checkResult() ? "FAILED" : "ok");
+	return checkResult();
+}
@@ -0,0 +1,111 @@
+/*reader/writer stress test of RcuHashTable's epoch reclamation - readers walk the table without locks while
+  a writer replaces, inserts and removes (rehashing on the way). a node freed too early shows up as a torn
+  element here, and as a use after free when built with -DSANITIZE=address (or a race with =thread).
+  usage: rcuStress [writer ops] [readers]. exits with 1 on the first failed check*/
+#include "../HashTable/rcuHashTable.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define STABLE_KEYS 500 //always present, the writer only replaces them
+#define KEY_RANGE (STABLE_KEYS * 4) //the rest come and go
+#define HOLD_SPINS 64 //a reader keeps some pointers this long so the writer retires them meanwhile
+
+/*v and w are written together, a reader that sees them differ read a node that was reused*/
+struct StressElement {
+	int key;
+	int v;
+	int w;
+
+	int operator()() const {
+		return key;
+	}
+	bool operator==(const StressElement& other) const {
+		return key == other.key;
+	}
+};
+
+static void readerLoop(RcuHashTable<StressElement>& table, std::atomic<bool>& stop, std::atomic<long>& reads) {
+	int reader = table.registerReader();
+	CHECK(reader >= 0);
+	if (reader < 0) return;
+	std::mt19937 rng(reader);
+	long n = 0;
+	while (!stop.load() && !failed.load()) {
+		RcuReadGuard<StressElement> guard(table, reader);
+		const StressElement* held = nullptr;
+		for (int k = 0; k < 16; k++) {
+			int key = (int)(rng() % KEY_RANGE);
+			const StressElement* found = table.find(StressElement{ key, 0, 0 }, key);
+			if (key < STABLE_KEYS) {
+				CHECK(found != nullptr);
+				if (found == nullptr) continue;
+				held = found;
+			}
+			if (found != nullptr) {
+				CHECK(found->key == key && found->v == found->w);
+			}
+			n++;
+		}
+		for (volatile int spin = 0; spin < HOLD_SPINS; spin++) {}
+		if (held != nullptr) { //still inside the read section, so it cant have been freed
+			CHECK(held->v == held->w);
+		}
+	}
+	reads += n;
+	table.unregisterReader(reader);
+}
+
+int main(int argc, char** argv) {
+	long ops = argc > 1 ? atol(argv[1]) : 200000;
+	int reader_count = argc > 2 ? atoi(argv[2]) : 3;
+	RcuHashTable<StressElement> table;
+	std::set<int> present;
+	for (int i = 0; i < STABLE_KEYS; i++) {
+		CHECK(table.insert(StressElement{ i, 0, 0 }, i));
+		present.insert(i);
+	}
+	CHECK(!table.insert(StressElement{ 3, 1, 1 }, 3));
+
+	std::atomic<bool> stop(false);
+	std::atomic<long> reads(0);
+	std::vector<std::thread> readers;
+	for (int r = 0; r < reader_count; r++) {
+		readers.emplace_back(readerLoop, std::ref(table), std::ref(stop), std::ref(reads));
+	}
+	std::mt19937 rng(1);
+	for (long i = 0; i < ops && !failed.load(); i++) {
+		int key = (int)(rng() % KEY_RANGE);
+		if (key < STABLE_KEYS) {
+			int v = (int)rng();
+			CHECK(table.replace(StressElement{ key, v, v }, key));
+		}
+		else if (rng() % 2) {
+			CHECK(table.insert(StressElement{ key, 1, 1 }, key) == present.insert(key).second);
+		}
+		else {
+			CHECK(table.remove(StressElement{ key, 0, 0 }, key) == (present.erase(key) == 1));
+		}
+	}
+	stop = true;
+	for (size_t r = 0; r < readers.size(); r++) readers[r].join();
+
+	table.synchronize();
+	CHECK(table.getPending() == 0);
+	CHECK(table.getCount() == (int)present.size());
+	int reader = table.registerReader();
+	StressElement out;
+	CHECK(table.get(reader, StressElement{ 7, 0, 0 }, 7, out) && out.key == 7 && out.v == out.w);
+	table.unregisterReader(reader);
+	for (int i = 0; i < KEY_RANGE; i++) table.remove(StressElement{ i, 0, 0 }, i);
+	CHECK(table.getCount() == 0);
+	printf("rcuStress: %ld writer ops, %ld reads by %d readers, final size %d: %s\n", ops, reads.load(),
+		reader_count, table.getSize(), failed.load() ? "FAILED" : "ok");
+	return checkResult();
+}
@@ -0,0 +1,156 @@
+/*RelaxedAVLtree's invariants against a reference map, checked on the nodes themselves:
+  - every key is where the search order puts it and every parent link matches
+  - the dirty nodes form a connected part at the top and getDirty/getTombstones count exactly the flags
+  - no node is deeper than getMaxDepth, and after rebalance the tree is a valid AVL tree with correct heights
+  copies (copy constructor, assignment, copyFrom from a relaxed or a plain tree) must keep all of it*/
+#include "../RelaxedAVLtree.h"
+#include "check.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+
+typedef RelaxedAVLtree<int, int> Relaxed;
+typedef Tnode<int, int> Node;
+
+/*the root is protected - a test only subclass reaches it like RelaxedAVLtree reaches AVLtree's*/
+class InspectedTree : public Relaxed {
+public:
+	explicit InspectedTree(int max_extra_depth = 2) : Relaxed(max_extra_depth) {}
+	Tnode<int, int>* getRoot() {
+		return this->root;
+	}
+};
+
+struct TreeFacts {
+	int nodes;
+	int dirty;
+	int tombstones;
+	int max_depth;
+	bool ordered;
+	bool linked;
+	bool dirty_connected; //a dirty node's parent is dirty too
+	bool balanced; //only meaningful with no dirty nodes
+};
+
+/*returns the real height (leaf = 0, like Tnode::height), depth counts edges from the root*/
+static int inspectAUX(Node* node, Node* parent, const int* low, const int* high, int depth, TreeFacts& facts) {
+	if (node == nullptr) {
+		return -1;
+	}
+	facts.nodes++;
+	facts.dirty += (node->flags & RELAXED_DIRTY) != 0;
+	facts.tombstones += (node->flags & RELAXED_TOMBSTONE) != 0;
+	facts.max_depth = depth > facts.max_depth ? depth : facts.max_depth;
+	if ((low != nullptr && node->key <= *low) || (high != nullptr && node->key >= *high)) facts.ordered = false;
+	if (node->parent != parent) facts.linked = false;
+	if ((node->flags & RELAXED_DIRTY) && parent != nullptr && (parent->flags & RELAXED_DIRTY) == 0) {
+		facts.dirty_connected = false;
+	}
+	int left = inspectAUX(node->left, node, low, &node->key, depth + 1, facts);
+	int right = inspectAUX(node->right, node, &node->key, high, depth + 1, facts);
+	int height = (left > right ? left : right) + 1;
+	if (node->height != height || left - right > 1 || right - left > 1) facts.balanced = false;
+	return height;
+}
+
+static void checkTree(InspectedTree& tree, const std::map<int, int>& reference, bool rebalanced) {
+	TreeFacts facts = { 0, 0, 0, 0, true, true, true, true };
+	inspectAUX(tree.getRoot(), nullptr, nullptr, nullptr, 0, facts);
+	CHECK(facts.ordered && facts.linked && facts.dirty_connected);
+	CHECK(facts.dirty == tree.getDirty() && facts.tombstones == tree.getTombstones());
+	CHECK(facts.nodes == tree.getSize() + tree.getTombstones());
+	CHECK(tree.getSize() == (int)reference.size());
+	CHECK(facts.max_depth <= tree.getMaxDepth());
+	if (rebalanced) {
+		CHECK(facts.dirty == 0 && facts.balanced);
+	}
+	for (std::map<int, int>::const_iterator it = reference.begin(); it != reference.end(); ++it) {
+		Node* found = tree.find(it->first);
+		CHECK(found != nullptr && found->value == it->second);
+	}
+}
+
+/*random inserts and removes with an occasional rebalance or compact, checked along the way*/
+static void randomOps(InspectedTree& tree, std::map<int, int>& reference, int seed, int ops) {
+	std::mt19937 rng(seed);
+	for (int i = 0; i < ops && !checkResult(); i++) {
+		int key = (int)(rng() % 20000);
+		int op = (int)(rng() % 1000);
+		if (op < 600) {
+			Node* node = tree.insert(key, i);
+			CHECK(node != nullptr && node->key == key);
+			if (reference.insert(std::make_pair(key, i)).second == false) {
+				CHECK(node->value == reference[key]); //an existing key keeps its value
+			}
+		}
+		else if (op < 995) {
+			CHECK(tree.remove(key) == (reference.erase(key) == 1));
+			CHECK(tree.find(key) == nullptr);
+		}
+		else if (op < 998) {
+			tree.rebalance();
+			checkTree(tree, reference, true);
+		}
+		else {
+			int tombstones = tree.getTombstones();
+			CHECK(tree.compact() == tombstones && tree.getTombstones() == 0);
+			checkTree(tree, reference, true);
+		}
+		if (i % 5000 == 0) {
+			checkTree(tree, reference, false);
+		}
+	}
+	checkTree(tree, reference, false);
+}
+
+int main() {
+	InspectedTree source(8); //a loose bound, so the copies get deeper trees than their own bound allows
+	std::map<int, int> reference;
+	randomOps(source, reference, 1, 100000);
+	source.rebalance();
+	std::mt19937 rng(4);
+	for (int i = 0; i < 3000; i++) { //ends on a write phase, with dirty nodes and tombstones left
+		int key = 20000 + (int)(rng() % 100000);
+		if (reference.insert(std::make_pair(key, i)).second) {
+			source.insert(key, i);
+		}
+		if (i % 3 == 0 && reference.erase(key) == 1) {
+			CHECK(source.remove(key));
+		}
+	}
+	checkTree(source, reference, false);
+	CHECK(source.getDirty() > 0 && source.getTombstones() > 0);
+
+	InspectedTree copied(1);
+	copied.insert(-1, -1); //replaced by the copy
+	copied.copyFrom(source);
+	CHECK(copied.getDirty() == 0 && copied.getTombstones() == source.getTombstones());
+	checkTree(copied, reference, true);
+	InspectedTree threaded(1);
+	threaded.copyFrom(source, 4);
+	checkTree(threaded, reference, true);
+	InspectedTree constructed(source);
+	checkTree(constructed, reference, false);
+	InspectedTree assigned;
+	assigned = source;
+	checkTree(assigned, reference, false);
+
+	std::map<int, int> plain_reference;
+	AVLtree<int, int> plain;
+	for (int i = 0; i < 1000; i++) {
+		plain.insert(i * 7, i);
+		plain_reference[i * 7] = i;
+	}
+	copied.copyFrom(plain);
+	checkTree(copied, plain_reference, true);
+
+	randomOps(copied, plain_reference, 2, 50000); //the copies keep working
+	std::map<int, int> threaded_reference(reference);
+	randomOps(threaded, threaded_reference, 3, 50000);
+	source.rebalance();
+	checkTree(source, reference, true);
+	printf("relaxedTree: %d keys, %d tombstones left: %s\n", source.getSize(), source.getTombstones(),
+		checkResult() ? "FAILED" : "ok");
+	return checkResult();
+}
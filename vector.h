@@ -4,43 +4,58 @@
 #include <iostream>
 #include <cstdlib>
 #include <new>
+#include <utility>
+#include "MemoryResource.h"
+#include "MemoryUsage.h"
 #define N 5
 
-/*Dynamic array - resized when its half full*/
+/*Dynamic array - resized when its half full
+  the pointer array is allocated from resource (the global heap by default)*/
 template <class T>
 class Vector {
     T** arr;
     int size;
+    int used; //one past the highest index added, the slots above it are slack
+    std::pmr::memory_resource* resource;
 
 public:
-    Vector() : arr(new T* [N]), size(N) {}
+    explicit Vector(std::pmr::memory_resource* _resource = std::pmr::get_default_resource())
+        : arr(allocateArray<T*>(_resource, N)), size(N), used(0), resource(_resource) {}
 
-    explicit Vector(int new_size) {
-        arr = new T*[new_size];
+    explicit Vector(int new_size, std::pmr::memory_resource* _resource = std::pmr::get_default_resource()) {
+        resource = _resource;
+        arr = allocateArray<T*>(resource, new_size);
         size = new_size;
+        used = 0;
     };
 
     ~Vector() {
-        delete[] arr;
+        deallocateArray(resource, arr, size);
     }
 
     Vector(const Vector& arr);
+    Vector(Vector&& arr); //takes arr's array and resource, arr is left with no capacity
     Vector<T>& operator=(const Vector& arr);
+    Vector<T>& operator=(Vector&& arr);
     T& operator[](int i);
     T operator[](int i) const;
     void add(int idx, T* elm);
     void resize();
     int getSize();
+    std::pmr::memory_resource* getResource();
+    MemoryUsage memoryUsage() const; //the pointer array and the vector object, not the elements pointed to
     void print();
 };
 
 /***********************FUNCTION IMPLEMENTATIONS*******************/
+/*like the std::pmr containers, a copy uses the default resource*/
 template <class T>
-inline Vector<T>::Vector(const Vector<T>& arr) {
-    arr = new T * [arr.size];
-    size = arr.size;
+inline Vector<T>::Vector(const Vector<T>& other) : resource(std::pmr::get_default_resource()) {
+    arr = allocateArray<T*>(resource, other.size);
+    size = other.size;
+    used = other.used;
     for (int i = 0; i < size; i++) {
-        arr[i] = arr.arr[i];
+        arr[i] = other.arr[i];
     }
 }
 
@@ -50,24 +65,53 @@ inline Vector<T>& Vector<T>::operator=(const Vector& other)
     if (this == &other) {
         return *this;
     }
-    delete[] arr;
-    arr = new T[other.size];
+    deallocateArray(resource, arr, size);
+    arr = allocateArray<T*>(resource, other.size);
     size = other.size;
+    used = other.used;
     for (int i = 0; i < size; i++) {
-        if (other != nullptr)
-            arr[i] = other.arr[i];
+        arr[i] = other.arr[i];
+    }
+    return *this;
+}
+
+template <class T>
+inline Vector<T>::Vector(Vector<T>&& other) : arr(other.arr), size(other.size), used(other.used), resource(other.resource) {
+    other.arr = nullptr;
+    other.size = 0; //resize() starts over from an empty array
+    other.used = 0;
+}
+
+/*the array can only be taken over from a vector of the same resource, otherwise it is copied*/
+template<class T>
+inline Vector<T>& Vector<T>::operator=(Vector&& other)
+{
+    if (this == &other) {
+        return *this;
     }
+    if (resource != other.resource) {
+        return *this = other;
+    }
+    deallocateArray(resource, arr, size);
+    arr = other.arr;
+    size = other.size;
+    used = other.used;
+    other.arr = nullptr;
+    other.size = 0;
+    other.used = 0;
     return *this;
 }
 
 template<class T>
 void Vector<T>::add(int idx, T* elm) {
-    if (size = idx * 2) { //array half full
+    while (idx * 2 >= size) { //array half full
         resize();
     }
 
     arr[idx] = elm;
-    size++;
+    if (idx >= used) {
+        used = idx + 1;
+    }
 }
 
 template <class T>
@@ -83,18 +127,19 @@ T Vector<T>::operator[](int i) const {
 
 template <class T>
 void Vector<T>::resize() {
+    int old_size = size; //the resource must get back the size it allocated
     if (size == 0) {
         size++;
     }
     auto new_size = 2 * size;
-    T** newArr = new T * [new_size];
+    T** newArr = allocateArray<T*>(resource, new_size);
     //memcpy
-    for (int i = 0; i < size; i++) {
+    for (int i = 0; i < old_size; i++) {
         newArr[i] = arr[i];
     }
 
+    deallocateArray(resource, arr, old_size);
     size = new_size;
-    delete[] arr;
     arr = newArr;
 }
 
@@ -104,6 +149,24 @@ inline int Vector<T>::getSize()
     return size;
 }
 
+template<class T>
+inline std::pmr::memory_resource* Vector<T>::getResource()
+{
+    return resource;
+}
+
+/*slots below used count as payload even if add skipped them, they were handed out as indexes*/
+template<class T>
+MemoryUsage Vector<T>::memoryUsage() const
+{
+    MemoryUsage usage = {};
+    usage.payload = (size_t)used * sizeof(T*);
+    usage.overhead = sizeof(Vector<T>);
+    usage.slack = (size_t)(size - used) * sizeof(T*);
+    usage.allocations = arr != nullptr ? 1 : 0;
+    return usage;
+}
+
 template<class T>
 inline void Vector<T>::print()
 {